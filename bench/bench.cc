@@ -0,0 +1,340 @@
+#define HEADLESS
+
+// before the headers that leave #pragma pack(1) set
+#include <fstream>
+#include "bench.h"
+
+#include "uct.h"
+#include "minimax.h"
+#include "montecarlo.h"
+#include "neural.h"
+#include "breakthrough.h"
+#include "congo.h"
+#include "connect4.h"
+#include "connect6.h"
+#include "druid.h"
+#include "druidhex.h"
+#include "tanbo.h"
+#include "ttt.h"
+#include "yavalath.h"
+
+//----------------------------------------------------------------------------
+//
+// Micro-benchmarks of the games' hot primitives and of the engines
+//
+//      bench [filter] [json file] [label]
+//
+// Only benchmarks whose name contains filter run ("" or "all" for every
+// one); the results are written as JSON to the file ("-" for stdout),
+// labelled e.g. with the commit being measured.
+//
+// Per game, over positions sampled from random games: moves(),
+// random_move(), copy_from(), move() (replaying the sampled games) and
+// random playouts from the initial position. For the engines: UCT
+// iterations, minimax nodes and FFNet forward passes.
+//
+//----------------------------------------------------------------------------
+
+static const size_t NUM_POSITIONS = 256;
+
+typedef connect4::State<7,6> Connect4State;
+typedef connect6::State<19, binomial_coeff<19*19,2>::result> Connect6State;
+typedef druid::State<5, 120, BitSquarePathFinder<5> > DruidState;
+typedef druidhex::State<5, 254, 254, 128> DruidHexState;
+
+// static path finders, as in the games' own mains
+template<> DruidState::PathFinder DruidState::path_finder(0);
+template<> druidhex::HexPathFinder<5> DruidHexState::path_finder(0);
+
+static volatile size_t SINK; // keeps results alive
+
+//----------------------------------------------------------------------------
+//
+// Game primitives
+//
+//----------------------------------------------------------------------------
+
+// the initial position, as Game::play sets it up
+template <typename S>
+void start(S &s) { s.clear(); }
+
+template <>
+void start(congo::State &s) { s.initial(); }
+
+template <typename S>
+struct Sample {
+        typedef typename S::ML ML;
+        typedef typename S::M M;
+
+        S *positions;
+        size_t count;
+        vector<vector<M> > games;
+        ML *ml; // some move lists are too large for the stack
+
+        Sample() : positions(new S[NUM_POSITIONS]), count(0), ml(new ML) {
+                S s;
+                while (count < NUM_POSITIONS) {
+                        start(s);
+                        if (s.game_over())
+                                DIE("game over in the initial position");
+                        games.push_back(vector<M>());
+                        M m;
+                        while (!s.game_over() && count < NUM_POSITIONS) {
+                                positions[count++].copy_from(s);
+                                if (!s.random_move(*ml, m))
+                                        break;
+                                s.move(m);
+                                games.back().push_back(m);
+                        }
+                }
+        }
+
+        ~Sample() {
+                delete[] positions;
+                delete ml;
+        }
+};
+
+template <typename S>
+struct MovesOp {
+        Sample<S> &sample;
+        MovesOp(Sample<S> &s) : sample(s) {}
+        size_t operator()() {
+                for (size_t i=0; i < sample.count; ++i) {
+                        sample.ml->clear();
+                        sample.positions[i].moves(*sample.ml);
+                        SINK += sample.ml->size();
+                }
+                return sample.count;
+        }
+};
+
+template <typename S>
+struct RandomMoveOp {
+        Sample<S> &sample;
+        RandomMoveOp(Sample<S> &s) : sample(s) {}
+        size_t operator()() {
+                typename S::M m;
+                for (size_t i=0; i < sample.count; ++i)
+                        SINK += sample.positions[i].random_move(*sample.ml, m);
+                return sample.count;
+        }
+};
+
+template <typename S>
+struct CopyOp {
+        Sample<S> &sample;
+        S s;
+        CopyOp(Sample<S> &sm) : sample(sm) {}
+        size_t operator()() {
+                for (size_t i=0; i < sample.count; ++i) {
+                        s.copy_from(sample.positions[i]);
+                        SINK += s.game_over();
+                }
+                return sample.count;
+        }
+};
+
+template <typename S>
+struct MoveOp {
+        Sample<S> &sample;
+        S s;
+        MoveOp(Sample<S> &sm) : sample(sm) {}
+        size_t operator()() {
+                size_t n = 0;
+                for (size_t g=0; g < sample.games.size(); ++g) {
+                        start(s);
+                        for (size_t i=0; i < sample.games[g].size(); ++i)
+                                s.move(sample.games[g][i]);
+                        n += sample.games[g].size();
+                }
+                SINK += s.game_over();
+                return n;
+        }
+};
+
+template <typename S>
+struct PlayoutOp {
+        Sample<S> &sample;
+        S s;
+        PlayoutOp(Sample<S> &sm) : sample(sm) {}
+        size_t operator()() {
+                start(s);
+                typename S::M m;
+                while (!s.game_over() && s.random_move(*sample.ml, m))
+                        s.move(m);
+                SINK += s.game_over();
+                return 1;
+        }
+};
+
+static const char *GAME_BENCHMARKS[] = { "moves", "random_move", "copy_from", "move", "playout" };
+
+template <typename S>
+void bench_game(Bench &bench, const string &game) {
+        string prefix = game + '.';
+        bool any = false;
+        for (size_t i=0; i < sizeof(GAME_BENCHMARKS) / sizeof(*GAME_BENCHMARKS); ++i)
+                any = any || bench.enabled(prefix + GAME_BENCHMARKS[i]);
+        if (!any)
+                return; // nothing to sample positions for
+
+        Sample<S> sample;
+        MovesOp<S> moves(sample);
+        RandomMoveOp<S> random_move(sample);
+        CopyOp<S> copy(sample);
+        MoveOp<S> move(sample);
+        PlayoutOp<S> playout(sample);
+
+        bench.run(prefix + "moves", "calls", moves);
+        bench.run(prefix + "random_move", "calls", random_move);
+        bench.run(prefix + "copy_from", "calls", copy);
+        bench.run(prefix + "move", "moves", move);
+        bench.run(prefix + "playout", "playouts", playout);
+}
+
+//----------------------------------------------------------------------------
+//
+// Engines
+//
+//----------------------------------------------------------------------------
+
+static const size_t UCT_ITER = 2000, MINIMAX_DEPTH = 5;
+
+struct UCTOp {
+        UCT<Connect4State, UCT_ITER, 7> uct;
+        Connect4State root, s;
+        UCTOp() { root.clear(); }
+        size_t operator()() {
+                s.copy_from(root);
+                uct.next(BLACK, s);
+                return UCT_ITER;
+        }
+};
+
+// the nodes Negamax visits to depth d, counted once so that each search
+// can be reported in nodes
+template <typename S>
+size_t count_nodes(S &state, int depth) {
+        if (state.game_over() || depth == 0)
+                return 1;
+        typename S::ML ml;
+        state.moves(ml);
+        size_t n = 1;
+        for (size_t i=0; i < ml.size(); ++i) {
+                S child;
+                child.copy_from(state);
+                child.move(ml[i]);
+                n += count_nodes(child, depth-1);
+        }
+        return n;
+}
+
+struct MinimaxOp {
+        Negamax<Connect4State> negamax;
+        Connect4State root;
+        size_t nodes;
+        MinimaxOp() {
+                root.clear();
+                nodes = count_nodes(root, MINIMAX_DEPTH);
+        }
+        size_t operator()() {
+                SINK += negamax.search(root, MINIMAX_DEPTH, true);
+                return nodes;
+        }
+};
+
+static const size_t NN_INPUT = 7*6*2, NN_HIDDEN = 64, NN_BATCH = 256;
+typedef FFNet<NN_INPUT, NN_HIDDEN, 1> BenchNet;
+
+// a minibatch through the armadillo net
+struct FpropOp {
+        BenchNet net;
+        BenchNet::Query q;
+        FpropOp() : q(NN_BATCH) { q.randomize(); }
+        size_t operator()() {
+                net.fprop(q);
+                SINK += q.output(0, 0) > 0.5;
+                return NN_BATCH;
+        }
+};
+
+// single positions through the compiled float net, as the searches use it
+struct FpropCompiledOp {
+        BenchNet net;
+        AlignedBuffer<float> input, hidden;
+        FpropCompiledOp() : input(NN_INPUT), hidden(BenchNet::HIDDEN_STRIDE) {
+                for (size_t i=0; i < NN_INPUT; ++i)
+                        input[i] = random() % 2;
+                net.compile();
+        }
+        size_t operator()() {
+                float output;
+                for (size_t i=0; i < NN_BATCH; ++i) {
+                        net.fprop_hidden(&input[0], &hidden[0]);
+                        net.fprop_output(&hidden[0], &output);
+                        SINK += output > 0.5;
+                }
+                return NN_BATCH;
+        }
+};
+
+void bench_engines(Bench &bench) {
+        if (bench.enabled("uct.iterations")) {
+                UCTOp op;
+                bench.run("uct.iterations", "iterations", op);
+        }
+        if (bench.enabled("minimax.nodes")) {
+                MinimaxOp op;
+                bench.run("minimax.nodes", "nodes", op);
+        }
+        if (bench.enabled("ffnet.fprop")) {
+                FpropOp op;
+                bench.run("ffnet.fprop", "positions", op);
+        }
+        if (bench.enabled("ffnet.fprop_compiled")) {
+                FpropCompiledOp op;
+                bench.run("ffnet.fprop_compiled", "positions", op);
+        }
+}
+
+//----------------------------------------------------------------------------
+//
+// Main
+//
+//----------------------------------------------------------------------------
+
+int main(int argc, char **argv) {
+        Bench bench;
+        if (argc > 1 && string(argv[1]) != "all")
+                bench.filter = argv[1];
+        const char *json  = (argc > 2) ? argv[2] : 0,
+                   *label = (argc > 3) ? argv[3] : "";
+
+        // the same positions and games on every run
+        srandom(1);
+        congo::populate();
+
+        bench_game<breakthrough::BTState>(bench, "breakthrough");
+        bench_game<congo::State>(bench, "congo");
+        bench_game<Connect4State>(bench, "connect4");
+        bench_game<Connect6State>(bench, "connect6");
+        bench_game<DruidState>(bench, "druid");
+        bench_game<DruidHexState>(bench, "druidhex");
+        bench_game<tanbo::State<9, 9*9> >(bench, "tanbo");
+        bench_game<ttt::State<3> >(bench, "ttt");
+        bench_game<yavalath::State<3, 4> >(bench, "yavalath");
+        bench_engines(bench);
+
+        if (json) {
+                if (string(json) == "-") {
+                        bench.write_json(cout, label);
+                } else {
+                        ofstream f(json);
+                        if (!f)
+                                DIE("cannot write " << json);
+                        bench.write_json(f, label);
+                }
+        }
+        return 0;
+}
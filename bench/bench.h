@@ -0,0 +1,103 @@
+#ifndef BENCH_H
+#define BENCH_H
+#pragma once
+
+#include "common.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+//
+// Bench
+//
+// Runs a benchmark as a functor whose operator() does one round of work
+// and returns the number of operations it did. The functor is first run
+// for `warmup` seconds (caches, branch predictors, lazily allocated pools),
+// then `reps` times for `seconds` each; a repetition's rate is its
+// operations per second. The median rate is reported along with the
+// minimum and maximum, so a noisy repetition does not move the result.
+//
+// Results are printed as they come and can be written as JSON, labelled
+// e.g. with the commit, for comparing runs.
+//
+//-----------------------------------------------------------------------------
+
+struct BenchResult {
+        string name, unit;
+        double median, min, max;
+        size_t reps;
+};
+
+struct Bench {
+        double warmup, seconds;
+        size_t reps;
+        string filter;  // run only benchmarks whose name contains it
+        vector<BenchResult> results;
+
+        Bench() : warmup(0.2), seconds(0.5), reps(5) {}
+
+        bool enabled(const string &name) const {
+                return filter.empty() || name.find(filter) != string::npos;
+        }
+
+        template <typename F>
+        void run(const string &name, const string &unit, F &f) {
+                if (!enabled(name))
+                        return;
+
+                Stopwatch sw;
+                while (sw.elapsed() < warmup)
+                        f();
+
+                vector<double> rates;
+                for (size_t r=0; r < reps; ++r) {
+                        size_t ops = 0;
+                        double elapsed = 0;
+                        sw.reset();
+                        do {
+                                ops += f();
+                                elapsed = sw.elapsed();
+                        } while (elapsed < seconds);
+                        rates.push_back(ops / elapsed);
+                }
+                std::sort(rates.begin(), rates.end());
+
+                BenchResult b;
+                b.name = name;
+                b.unit = unit;
+                b.median = rates[rates.size() / 2];
+                b.min = rates.front();
+                b.max = rates.back();
+                b.reps = reps;
+                results.push_back(b);
+
+                cout << std::left << setw(32) << name << std::right
+                     << setw(14) << std::fixed << std::setprecision(0) << b.median
+                     << ' ' << unit << "/s  [" << b.min << ", " << b.max << ']'
+                     << endl;
+        }
+
+        void write_json(ostream &o, const string &label) const {
+                o.unsetf(ios::floatfield);
+                o << std::setprecision(6);
+                o << "{\"label\": \"" << label << "\""
+                  << ", \"warmup\": " << warmup
+                  << ", \"seconds\": " << seconds
+                  << ", \"reps\": " << reps
+                  << ", \"benchmarks\": [";
+                for (size_t i=0; i < results.size(); ++i) {
+                        const BenchResult &b = results[i];
+                        o << (i ? ", " : "")
+                          << "{\"name\": \"" << b.name << "\""
+                          << ", \"unit\": \"" << b.unit << "\""
+                          << ", \"rate\": " << b.median
+                          << ", \"min\": " << b.min
+                          << ", \"max\": " << b.max << '}';
+                }
+                o << "]}" << endl;
+        }
+};
+
+#endif // BENCH_H
@@ -0,0 +1,70 @@
+#-----------------------------------------------------------------------------
+#
+# Build configuration, included by the Makefiles in games/, test/ and bench/
+#
+#       make [PROFILE=debug|release] [HEADLESS=1]
+#       make release | headless | pgo
+#
+# debug builds with -g and no optimisation; release with -O3 -march=native
+# and link-time optimisation. HEADLESS=1 defines HEADLESS, so the game boards
+# open no windows, and does not link GLFW or OpenGL.
+#
+# pgo builds $(PGO_EXES) instrumented, runs $(PGO_TRAIN) and rebuilds them
+# with the profile. GCC keeps one profile per object file, so only the
+# executables the training run exercises are built.
+#
+# Objects remember the profile they were built with: switching profiles
+# rebuilds everything.
+#
+#-----------------------------------------------------------------------------
+
+PROFILE	?= debug
+
+.DEFAULT_GOAL := all
+
+UNAME	:= $(shell uname -s)
+ifeq ($(UNAME),Darwin)
+SYS_LIBS = -larmadillo -framework Accelerate
+GL_LIBS	= -lglfw -framework OpenGL -framework Cocoa
+else
+SYS_LIBS = -larmadillo -lpthread
+GL_LIBS	= -lglfw -lGL
+endif
+
+OPT_debug	= -g
+OPT_release	= -O3 -march=native -flto=auto
+OPT_pgo-gen	= $(OPT_release) -fprofile-generate
+# threads race on the profile counters
+OPT_pgo-use	= $(OPT_release) -fprofile-use -fprofile-correction
+OPT	= $(OPT_$(PROFILE))
+ifeq ($(OPT),)
+$(error unknown PROFILE $(PROFILE) (debug, release))
+endif
+
+ifdef HEADLESS
+OPT	+= -DHEADLESS
+GL_LIBS	=
+endif
+
+BUILD_STAMP = .build-$(PROFILE)$(if $(HEADLESS),-headless)
+
+$(BUILD_STAMP):
+	@$(RM) .build-*
+	@touch $@
+
+.PHONY: release headless pgo config-clean
+
+release:
+	$(MAKE) PROFILE=release
+
+headless:
+	$(MAKE) HEADLESS=1
+
+pgo:
+	$(RM) *.gcda
+	$(MAKE) PROFILE=pgo-gen $(PGO_EXES)
+	$(PGO_TRAIN)
+	$(MAKE) PROFILE=pgo-use $(PGO_EXES)
+
+config-clean:
+	$(RM) .build-* *.gcda
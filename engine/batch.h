@@ -0,0 +1,202 @@
+#ifndef BATCH_H
+#define BATCH_H
+#pragma once
+
+#include "common.h"
+#include "thread.h"
+#include "stats.h"
+
+#include <vector>
+
+//-----------------------------------------------------------------------------
+//
+// Batch
+//
+// Plays num_games games of G (a Game<S,B,W>) with no output, on one or more
+// worker threads, timing every move. Reports throughput (games and moves
+// per second of wall time, time per move of each side) and results (win
+// rates by colour); the games can be written as CSV and the summary as
+// JSON. Build with HEADLESS so the game boards open no windows, and with
+// LOG_LEVEL=LOG_NONE so the engines do not log every move; the summary is
+// written to a stream of its own.
+//
+// As with Tournament, each game is a new G, and workers share the cores
+// with the players' own threads. Built with STATS, the engines' per-move
+// logs are turned off and their totals (SearchStats::total()) reported.
+//
+//-----------------------------------------------------------------------------
+
+template <typename G>
+struct Batch {
+        struct Record {
+                size_t game, moves[3];  // moves and seconds by Color
+                double seconds[3];
+                Color winner;
+        };
+
+        size_t num_games, workers;
+        vector<Record> records;
+        Mutex mutex;
+        volatile size_t next_game;
+        double wall;
+
+        Batch(size_t n, size_t w=1)
+                : num_games(n), workers(w), next_game(0), wall(0)
+        {}
+
+        static Record play(size_t i) {
+                Record r;
+                memset(&r, 0, sizeof(r));
+                r.game = i;
+
+                G game;
+                game.state.clear();
+                Color player = BLACK;
+                while (!game.state.game_over()) {
+                        Stopwatch sw;
+                        if (player == BLACK)
+                                game.black.next(BLACK, game.state);
+                        else game.white.next(WHITE, game.state);
+                        r.seconds[player] += sw.elapsed();
+                        r.moves[player]++;
+                        player = other(player);
+                }
+                r.winner = game.state.winner();
+                return r;
+        }
+
+        void work() {
+                while (true) {
+                        size_t i = __sync_fetch_and_add(&next_game, 1);
+                        if (i >= num_games)
+                                return;
+                        Record r = play(i);
+                        Lock lock(mutex);
+                        records.push_back(r);
+                }
+        }
+
+        static void *spawn_thread(void *self) {
+                ((Batch *) self)->work();
+                return NULL;
+        }
+
+        void run() {
+                records.clear();
+                records.reserve(num_games);
+                next_game = 0;
+                STATS_ONLY(STATS_LOG = false;)
+
+                Stopwatch sw;
+                size_t n = std::max<size_t>(std::min(workers, num_games), 1);
+                vector<pthread_t> threads(n);
+                for (size_t i=0; i < n; ++i)
+                        pthread_create(&threads[i], NULL, spawn_thread, this);
+                for (size_t i=0; i < n; ++i)
+                        pthread_join(threads[i], NULL);
+                wall = sw.elapsed();
+        }
+
+        //-------------------------------------------------------------------
+        //
+        // Summary
+        //
+        //-------------------------------------------------------------------
+
+        size_t wins(Color c) const {
+                size_t n = 0;
+                for (size_t i=0; i < records.size(); ++i)
+                        n += records[i].winner == c;
+                return n;
+        }
+
+        size_t moves(Color c) const {
+                size_t n = 0;
+                for (size_t i=0; i < records.size(); ++i)
+                        n += records[i].moves[c];
+                return n;
+        }
+
+        double seconds(Color c) const {
+                double s = 0;
+                for (size_t i=0; i < records.size(); ++i)
+                        s += records[i].seconds[c];
+                return s;
+        }
+
+        size_t moves() const { return moves(BLACK) + moves(WHITE); }
+
+        double per_second(size_t n) const { return wall > 0 ? n / wall : 0; }
+
+        double ms_per_move(Color c) const {
+                return moves(c) ? 1000 * seconds(c) / moves(c) : 0;
+        }
+
+        double rate(size_t n) const {
+                return records.empty() ? 0 : double(n) / records.size();
+        }
+
+        static const char *name(Color c) {
+                switch (c) {
+                case BLACK: return "black";
+                case WHITE: return "white";
+                default: return "none";
+                }
+        }
+
+        void report(ostream &o, const char *title) const {
+                o << title << ": " << records.size() << " games"
+                  << " in " << wall << "s, workers=" << workers
+                  << " games/s=" << per_second(records.size())
+                  << " moves/s=" << per_second(moves())
+                  << " ms/move black=" << ms_per_move(BLACK)
+                  << " white=" << ms_per_move(WHITE)
+                  << " wins black=" << rate(wins(BLACK))
+                  << " white=" << rate(wins(WHITE))
+                  << " draws=" << rate(wins(NONE)) << endl;
+                STATS_ONLY(SearchStats::total().write(o, title); o << endl;)
+        }
+
+        // one row per game, in order of completion
+        void write_csv(ostream &o) const {
+                o << "game,winner,black_moves,white_moves,black_seconds,white_seconds" << endl;
+                for (size_t i=0; i < records.size(); ++i) {
+                        const Record &r = records[i];
+                        o << r.game << ',' << name(r.winner) << ','
+                          << r.moves[BLACK] << ',' << r.moves[WHITE] << ','
+                          << r.seconds[BLACK] << ',' << r.seconds[WHITE] << endl;
+                }
+        }
+
+        void write_json(ostream &o, const char *title) const {
+                o << "{\"name\": \"" << title << "\""
+                  << ", \"games\": " << records.size()
+                  << ", \"workers\": " << workers
+                  << ", \"seconds\": " << wall
+                  << ", \"games_per_second\": " << per_second(records.size())
+                  << ", \"moves_per_second\": " << per_second(moves())
+                  << ", \"ms_per_move\": {\"black\": " << ms_per_move(BLACK)
+                  << ", \"white\": " << ms_per_move(WHITE) << '}'
+                  << ", \"win_rate\": {\"black\": " << rate(wins(BLACK))
+                  << ", \"white\": " << rate(wins(WHITE))
+                  << ", \"draw\": " << rate(wins(NONE)) << '}';
+#ifdef STATS
+                const SearchStats &s = SearchStats::total();
+                o << ", \"search\": {\"moves\": " << s.moves
+                  << ", \"playouts\": " << s.playouts
+                  << ", \"expanded\": " << s.expanded
+                  << ", \"max_depth\": " << s.max_depth
+                  << ", \"nodes\": " << s.nodes
+                  << ", \"cutoffs\": " << s.cutoffs
+                  << ", \"movegen\": " << s.movegen
+                  << ", \"rollout_moves\": " << s.rollout_moves
+                  << ", \"seconds\": {\"select\": " << s.select
+                  << ", \"expand\": " << s.expand
+                  << ", \"rollout\": " << s.rollout
+                  << ", \"backprop\": " << s.backprop << "}}";
+#endif
+                o << '}' << endl;
+        }
+};
+
+#endif // BATCH_H
@@ -3,6 +3,10 @@
 
 #include "common.h"
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 //-----------------------------------------------------------------------------
 //
 // Utility
@@ -148,4 +152,319 @@ struct bitboard : public bitfield<uint64_t> {
         void try_set(int x, int y) { if (valid(x, y)) set(x, y); }
 };
 
+
+//-----------------------------------------------------------------------------
+//
+// WideBitboard
+//
+// WIDTH x HEIGHT board on an array of 64-bit words, bit index x+y*WIDTH, for
+// boards larger than 8x8 (WIDTH must be below 63). Bits beyond the board
+// area are always zero. Direction shifts mask the bits that would wrap
+// around an edge, so N/S/E/W and the diagonals behave like moves on the board
+// (N is y-1, E is x+1, as in the games). The six hex directions assume axial
+// coordinates (see dilate6).
+//
+//-----------------------------------------------------------------------------
+
+template <size_t WIDTH, size_t HEIGHT>
+struct WideBitboard {
+        enum { AREA=WIDTH*HEIGHT, WORDS=(AREA+63)/64 };
+        enum Direction { N, S, E, W, NE, NW, SE, SW };
+
+        typedef WideBitboard<WIDTH,HEIGHT> BB;
+
+        uint64_t data[WORDS];
+
+        WideBitboard() { reset(); }
+
+        static size_t index(size_t x, size_t y) { return x+y*WIDTH; }
+
+        //---------------------------------------------------------------------
+        // single bits (std::bitset compatible)
+        //---------------------------------------------------------------------
+
+        bool operator[](size_t i) const { return (data[i>>6] >> (i&63)) & 1ULL; }
+        bool test(size_t i) const { return (*this)[i]; }
+        bool get(size_t x, size_t y) const { return (*this)[index(x,y)]; }
+
+        BB& set(size_t i) { data[i>>6] |= 1ULL << (i&63); return *this; }
+        BB& set(size_t x, size_t y) { return set(index(x,y)); }
+        BB& reset(size_t i) { data[i>>6] &= ~(1ULL << (i&63)); return *this; }
+        BB& reset() { memset(data, 0, sizeof(data)); return *this; }
+        BB& flip(size_t i) { data[i>>6] ^= 1ULL << (i&63); return *this; }
+
+        size_t count() const {
+                size_t c = 0;
+                for (size_t i=0; i < WORDS; ++i)
+                        c += popcount(data[i]);
+                return c;
+        }
+
+        bool any() const {
+                uint64_t x = 0;
+                for (size_t i=0; i < WORDS; ++i)
+                        x |= data[i];
+                return x != 0;
+        }
+
+        bool none() const { return !any(); }
+
+        bool operator == (const BB &r) const {
+                uint64_t x = 0;
+                for (size_t i=0; i < WORDS; ++i)
+                        x |= data[i] ^ r.data[i];
+                return x == 0;
+        }
+        bool operator != (const BB &r) const { return !(*this == r); }
+
+        // index of the lowest set bit, AREA if empty
+        size_t first() const {
+                for (size_t i=0; i < WORDS; ++i)
+                        if (data[i])
+                                return (i<<6) + __builtin_ctzll(data[i]);
+                return AREA;
+        }
+
+        // clear and return the lowest set bit, AREA if empty
+        size_t pop_first() {
+                for (size_t i=0; i < WORDS; ++i) {
+                        if (data[i]) {
+                                size_t k = (i<<6) + __builtin_ctzll(data[i]);
+                                data[i] &= data[i]-1; // reset LS1B
+                                return k;
+                        }
+                }
+                return AREA;
+        }
+
+        // the k-th set bit (counting from 0), AREA if there are fewer
+        size_t nth(size_t k) const {
+                for (size_t i=0; i < WORDS; ++i) {
+                        size_t c = popcount(data[i]);
+                        if (k < c) {
+                                uint64_t x = data[i];
+                                while (k--)
+                                        x &= x-1;
+                                return (i<<6) + __builtin_ctzll(x);
+                        }
+                        k -= c;
+                }
+                return AREA;
+        }
+
+        //---------------------------------------------------------------------
+        // set algebra
+        //---------------------------------------------------------------------
+
+#ifdef __AVX2__
+#define WIDE_BITBOARD_OP(op, vop) \
+        BB& operator op##= (const BB &r) { \
+                size_t i=0; \
+                for (; i+4 <= WORDS; i += 4) { \
+                        __m256i a = _mm256_loadu_si256((const __m256i *) (data+i)), \
+                                b = _mm256_loadu_si256((const __m256i *) (r.data+i)); \
+                        _mm256_storeu_si256((__m256i *) (data+i), vop(a, b)); \
+                } \
+                for (; i < WORDS; ++i) \
+                        data[i] op##= r.data[i]; \
+                return *this; \
+        }
+#else
+#define WIDE_BITBOARD_OP(op, vop) \
+        BB& operator op##= (const BB &r) { \
+                for (size_t i=0; i < WORDS; ++i) \
+                        data[i] op##= r.data[i]; \
+                return *this; \
+        }
+#endif
+
+        WIDE_BITBOARD_OP(&, _mm256_and_si256)
+        WIDE_BITBOARD_OP(|, _mm256_or_si256)
+        WIDE_BITBOARD_OP(^, _mm256_xor_si256)
+#undef WIDE_BITBOARD_OP
+
+        BB operator & (const BB &r) const { BB b(*this); return b &= r; }
+        BB operator | (const BB &r) const { BB b(*this); return b |= r; }
+        BB operator ^ (const BB &r) const { BB b(*this); return b ^= r; }
+
+        BB operator ~ () const {
+                BB b;
+                for (size_t i=0; i < WORDS; ++i)
+                        b.data[i] = ~data[i];
+                return b &= valid();
+        }
+
+        // this & ~r
+        BB andnot(const BB &r) const {
+                BB b;
+                for (size_t i=0; i < WORDS; ++i)
+                        b.data[i] = data[i] & ~r.data[i];
+                return b;
+        }
+
+        //---------------------------------------------------------------------
+        // masks
+        //---------------------------------------------------------------------
+
+        static BB make_column(size_t x) {
+                BB b;
+                for (size_t y=0; y < HEIGHT; ++y)
+                        b.set(x, y);
+                return b;
+        }
+
+        static BB make_row(size_t y) {
+                BB b;
+                for (size_t x=0; x < WIDTH; ++x)
+                        b.set(x, y);
+                return b;
+        }
+
+        static const BB& valid() {
+                static const BB b = BB().fill_area();
+                return b;
+        }
+
+        static const BB& not_west_edge() {
+                static const BB b = valid().andnot(make_column(0));
+                return b;
+        }
+
+        static const BB& not_east_edge() {
+                static const BB b = valid().andnot(make_column(WIDTH-1));
+                return b;
+        }
+
+        //---------------------------------------------------------------------
+        // shifts
+        //---------------------------------------------------------------------
+
+        // raw shifts towards higher/lower bit indices, 0 < n < 64; shl may
+        // leave bits past the board area, which the callers mask
+        BB shl(size_t n) const {
+                BB b;
+                for (size_t i=WORDS-1; i > 0; --i)
+                        b.data[i] = (data[i] << n) | (data[i-1] >> (64-n));
+                b.data[0] = data[0] << n;
+                return b;
+        }
+
+        BB shr(size_t n) const {
+                BB b;
+                for (size_t i=0; i+1 < WORDS; ++i)
+                        b.data[i] = (data[i] >> n) | (data[i+1] << (64-n));
+                b.data[WORDS-1] = data[WORDS-1] >> n;
+                return b;
+        }
+
+        BB north() const { return shr(WIDTH); }
+        BB south() const { return shl(WIDTH) & valid(); }
+        BB east()  const { return shl(1) & not_west_edge(); }
+        BB west()  const { return shr(1) & not_east_edge(); }
+        BB north_east() const { return shr(WIDTH-1) & not_west_edge(); }
+        BB north_west() const { return shr(WIDTH+1) & not_east_edge(); }
+        BB south_east() const { return shl(WIDTH+1) & not_west_edge(); }
+        BB south_west() const { return shl(WIDTH-1) & not_east_edge(); }
+
+        BB shift(Direction d) const {
+                switch (d) {
+                case N:  return north();
+                case S:  return south();
+                case E:  return east();
+                case W: return west();
+                case NE: return north_east();
+                case NW: return north_west();
+                case SE: return south_east();
+                case SW: return south_west();
+                }
+                DIE("unknown direction: " << d);
+        }
+
+        //---------------------------------------------------------------------
+        // dilation and flood fill
+        //---------------------------------------------------------------------
+
+        // squares next to a set square (not the set squares themselves,
+        // unless they are next to another one)
+        BB neighbours4() const {
+                BB b = (shl(1) & not_west_edge()) | (shr(1) & not_east_edge());
+                b |= shl(WIDTH) | shr(WIDTH);
+                return b & valid();
+        }
+
+        BB neighbours8() const {
+                BB h = (shl(1) & not_west_edge()) | (shr(1) & not_east_edge());
+                BB b = h | *this;
+                return (h | b.shl(WIDTH) | b.shr(WIDTH)) & valid();
+        }
+
+        // hex neighbourhood in axial coordinates: the six neighbours of
+        // (x,y) are (x±1,y), (x,y±1), (x-1,y-1) and (x+1,y+1)
+        BB neighbours6() const {
+                BB b = (shl(1) | shl(WIDTH+1)) & not_west_edge();
+                b |= (shr(1) | shr(WIDTH+1)) & not_east_edge();
+                b |= shl(WIDTH) | shr(WIDTH);
+                return b & valid();
+        }
+
+        BB dilate4() const { return neighbours4() | *this; }
+        BB dilate6() const { return neighbours6() | *this; }
+        BB dilate8() const { return neighbours8() | *this; }
+
+        // grow seed inside mask until nothing changes
+        static BB fill4(BB seed, const BB &mask) {
+                seed &= mask;
+                for (;;) {
+                        BB next = seed.dilate4() & mask;
+                        if (next == seed)
+                                return seed;
+                        seed = next;
+                }
+        }
+
+        static BB fill6(BB seed, const BB &mask) {
+                seed &= mask;
+                for (;;) {
+                        BB next = seed.dilate6() & mask;
+                        if (next == seed)
+                                return seed;
+                        seed = next;
+                }
+        }
+
+        static BB fill8(BB seed, const BB &mask) {
+                seed &= mask;
+                for (;;) {
+                        BB next = seed.dilate8() & mask;
+                        if (next == seed)
+                                return seed;
+                        seed = next;
+                }
+        }
+
+        //---------------------------------------------------------------------
+        // representation
+        //---------------------------------------------------------------------
+
+        string str() const {
+                stringstream s;
+                for (size_t y=0; y < HEIGHT; ++y) {
+                        for (size_t x=0; x < WIDTH; ++x)
+                                s << (get(x,y) ? '1' : '.') << ' ';
+                        s << endl;
+                }
+                return s.str();
+        }
+
+private:
+        // every square of the board; only used to build valid()
+        BB& fill_area() {
+                for (size_t i=0; i < WORDS; ++i)
+                        data[i] = ~0ULL;
+                if (AREA & 63)
+                        data[WORDS-1] = ~(~0ULL << (AREA & 63));
+                return *this;
+        }
+};
+
 #endif // BITBOARD_H
@@ -17,6 +17,7 @@
 
 extern "C" {
 #include <stdint.h>
+#include <sys/time.h>
 }
 
 using namespace std;
@@ -30,11 +31,35 @@ struct Timer {
 
 static Timer TIMER;
 
-#define DEBUG(x)  //cout << x << endl << flush
+// wall clock with microsecond resolution, for throughput measurements
+struct Stopwatch {
+        struct timeval start;
+        Stopwatch() { reset(); }
+        void reset() { gettimeofday(&start, NULL); }
+        double elapsed() const {
+                struct timeval now;
+                gettimeofday(&now, NULL);
+                return double(now.tv_sec - start.tv_sec)
+                     + double(now.tv_usec - start.tv_usec) * 1e-6;
+        }
+};
+
+#include "log.h"
+
+#if LOG_LEVEL >= LOG_DEBUG
+#define DEBUG(x)  LOG_WRITE(x)
+#else
+#define DEBUG(x)
+#endif
 
-#define LOG(x)  { cout << '[' << TIMER.elapsed() << "] " << x << endl << flush; }
+#if LOG_LEVEL >= LOG_INFO
+#define LOG(x)  LOG_WRITE(x)
+#else
+#define LOG(x)
+#endif
 
-#define DIE(x)  { cerr << '[' << TIMER.elapsed() << ' ' \
+#define DIE(x)  { log_flush(); \
+                  cerr << '[' << TIMER.elapsed() << ' ' \
                        << __FILE__ << ':' << __LINE__ << "] " \
                        x << endl << flush; exit(-1); }
 
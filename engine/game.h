@@ -23,7 +23,10 @@ struct Game {
 
         Color play(bool verbose=true) {
                 state.clear();
-                if (verbose) state.print();
+                if (verbose) {
+                        log_flush(); // lines logged before the game first
+                        state.print();
+                }
                 Color player = BLACK;
                 while (!state.game_over()) {
                         switch (player) {
@@ -31,8 +34,10 @@ struct Game {
                         case WHITE: white.next(WHITE, state); break;
                         case NONE: assert(player != NONE);
                         }
-                        if (verbose)
+                        if (verbose) {
+                                log_flush(); // the engine's lines first
                                 state.print();
+                        }
                         player = other(player);
                 }
                 if (verbose)
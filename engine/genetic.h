@@ -3,11 +3,247 @@
 
 #include "common.h"
 #include "thread.h"
+#include "memory.h"
+#ifndef HEADLESS
 #include "../ui/plot.h"
+#endif
 
 #include <vector>
 #include <algorithm>
 
+// With ARENA, everything a pool allocates during one generation comes from
+// one of two arenas of the pool, alternating: Policy::iterate() must build
+// the new generation from fresh allocations (copies) so that the arena of
+// the generation before can be cleared wholesale. Migrants are copied to the
+// heap since they outlive their pool's arenas.
+#if defined(ARENA) && !defined(DEEP_COPY)
+#error "ARENA requires DEEP_COPY"
+#endif
+
+
+//-----------------------------------------------------------------------------
+//
+// FitnessCache
+//
+// Bounded map from the hash of an individual (e.g. canonical_hash() of a
+// Node tree) to its fitness, shared by all pools so that duplicates, bred in
+// a pool or arriving by migration, are scored once. Keys are spread over
+// SHARDS separately locked shards, each evicting its least recently used
+// entry when full. Collisions of 64 bit keys are not detected.
+//
+//-----------------------------------------------------------------------------
+
+struct FitnessCache {
+        enum { SHARD_BITS = 4, SHARDS = 1 << SHARD_BITS };
+        enum { NIL = ~0u };
+
+        struct Entry {
+                uint64_t key;
+                double value;
+                unsigned prev, next, // LRU list, most recent first
+                         chain;      // next entry in the bucket
+        };
+
+        struct Shard {
+                Mutex mutex;
+                vector<Entry> entries;
+                vector<unsigned> buckets;
+                unsigned head, tail;
+                size_t capacity, hits, misses;
+
+                void init(size_t cap) {
+                        capacity = std::max<size_t>(cap, 1);
+                        entries.clear();
+                        entries.reserve(capacity);
+                        size_t n = 1;
+                        while (n < capacity)
+                                n <<= 1;
+                        buckets.assign(n, NIL);
+                        head = tail = NIL;
+                        hits = misses = 0;
+                }
+
+                unsigned &bucket(uint64_t key) { return buckets[key & (buckets.size()-1)]; }
+
+                unsigned find(uint64_t key) {
+                        for (unsigned i = bucket(key); i != NIL; i = entries[i].chain)
+                                if (entries[i].key == key)
+                                        return i;
+                        return NIL;
+                }
+
+                void unlink(unsigned i) {
+                        Entry &e = entries[i];
+                        if (e.prev != NIL) entries[e.prev].next = e.next; else head = e.next;
+                        if (e.next != NIL) entries[e.next].prev = e.prev; else tail = e.prev;
+                }
+
+                void push_front(unsigned i) {
+                        Entry &e = entries[i];
+                        e.prev = NIL;
+                        e.next = head;
+                        if (head != NIL) entries[head].prev = i; else tail = i;
+                        head = i;
+                }
+
+                void touch(unsigned i) {
+                        if (i != head) {
+                                unlink(i);
+                                push_front(i);
+                        }
+                }
+
+                bool lookup(uint64_t key, double &value) {
+                        Lock lock(mutex);
+                        unsigned i = find(key);
+                        if (i == NIL) {
+                                ++misses;
+                                return false;
+                        }
+                        ++hits;
+                        value = entries[i].value;
+                        touch(i);
+                        return true;
+                }
+
+                void insert(uint64_t key, double value) {
+                        Lock lock(mutex);
+                        unsigned i = find(key);
+                        if (i != NIL) {
+                                entries[i].value = value;
+                                touch(i);
+                                return;
+                        }
+                        if (entries.size() < capacity) {
+                                i = entries.size();
+                                entries.push_back(Entry());
+                        } else {
+                                // evict the least recently used
+                                i = tail;
+                                unlink(i);
+                                unsigned *p = &bucket(entries[i].key);
+                                while (*p != i)
+                                        p = &entries[*p].chain;
+                                *p = entries[i].chain;
+                        }
+                        Entry &e = entries[i];
+                        e.key = key;
+                        e.value = value;
+                        e.chain = bucket(key);
+                        bucket(key) = i;
+                        push_front(i);
+                }
+        };
+
+        Shard shards[SHARDS];
+
+        FitnessCache(size_t capacity) {
+                for (size_t i=0; i < SHARDS; ++i)
+                        shards[i].init((capacity + SHARDS-1) / SHARDS);
+        }
+
+        // the high bits pick the shard, the low bits the bucket
+        Shard &shard(uint64_t key) { return shards[key >> (64 - SHARD_BITS)]; }
+
+        bool lookup(uint64_t key, double &value) { return shard(key).lookup(key, value); }
+        void insert(uint64_t key, double value) { shard(key).insert(key, value); }
+
+        void clear() {
+                for (size_t i=0; i < SHARDS; ++i) {
+                        Lock lock(shards[i].mutex);
+                        shards[i].init(shards[i].capacity);
+                }
+        }
+
+        size_t size() const {
+                size_t n = 0;
+                for (size_t i=0; i < SHARDS; ++i) n += shards[i].entries.size();
+                return n;
+        }
+        size_t hits() const {
+                size_t n = 0;
+                for (size_t i=0; i < SHARDS; ++i) n += shards[i].hits;
+                return n;
+        }
+        size_t misses() const {
+                size_t n = 0;
+                for (size_t i=0; i < SHARDS; ++i) n += shards[i].misses;
+                return n;
+        }
+        double hit_rate() const {
+                size_t h = hits(), m = misses();
+                return h + m ? double(h) / (h + m) : 0;
+        }
+
+private:
+        FitnessCache(const FitnessCache &);
+        FitnessCache& operator=(const FitnessCache &);
+};
+
+
+//-----------------------------------------------------------------------------
+//
+// Mailbox
+//
+// Bounded single producer, single consumer queue without locks, carrying
+// migrants from one pool to the next: only the producer moves tail and only
+// the consumer moves head, each after a full barrier so the slot it wrote or
+// read is settled first. The indices are kept on separate cache lines.
+//
+//-----------------------------------------------------------------------------
+
+template <typename T, size_t N=4>
+struct Mailbox {
+        T slots[N];
+        volatile size_t head;
+        char pad[64];
+        volatile size_t tail;
+
+        Mailbox() : head(0), tail(0) {}
+
+        bool push(const T &x) {
+                size_t t = tail;
+                if (t - head == N)
+                        return false;
+                slots[t % N] = x;
+                __sync_synchronize();
+                tail = t+1;
+                return true;
+        }
+
+        bool pop(T &x) {
+                size_t h = head;
+                if (h == tail)
+                        return false;
+                __sync_synchronize();
+                x = slots[h % N];
+                __sync_synchronize();
+                head = h+1;
+                return true;
+        }
+};
+
+//-----------------------------------------------------------------------------
+//
+// RunControl
+//
+// When Population::run() stops: after a number of generations of every
+// pool, after some wall time, or once the best individual of any pool has
+// Policy::fitness() at or below a target (lower is better, as with
+// Policy::compare()). Zero limits and has_target=false mean no limit.
+//
+//-----------------------------------------------------------------------------
+
+struct RunControl {
+        enum Reason { RUNNING, GENERATIONS, TIME, TARGET };
+
+        size_t generations;
+        double seconds,
+               target;
+        bool has_target;
+
+        RunControl() : generations(0), seconds(0), target(0), has_target(false) {}
+};
 
 template <typename T,
           typename Policy>
@@ -16,7 +252,6 @@ struct Pool {
         size_t size;
         vector<T> pop;
         size_t id;
-        Mutex mutex;
 
         Pool(size_t s, size_t i) : size(s), pop(size), id(i) {
                 clear();
@@ -56,30 +291,104 @@ struct Pool {
         };
 
         void sort() { std::sort(pop.begin(), pop.end(), Sorter(id)); }
+
+        // only the best k in front, in order
+        void order(size_t k) {
+                k = std::min(k, pop.size());
+                std::partial_sort(pop.begin(), pop.begin() + k, pop.end(), Sorter(id));
+        }
+
+        size_t worst() const {
+                size_t w = 0;
+                for (size_t i=1; i < pop.size(); ++i)
+                        if (Policy::compare(pop[w], pop[i], id))
+                                w = i;
+                return w;
+        }
 };
 
+// Islands of pools, each evolved by its own thread with Policy::iterate()
+// and sending a copy of its best to the next pool every MIGRATION
+// generations. Between generations only the ELITE best of a pool are kept in
+// order at the front, which is all iterate() may rely on.
 template <typename T,
           typename Policy>
 struct Population {
+        enum { MIGRATION = 800, ELITE = 2 };
+
         std::vector< Pool<T,Policy> > pools;
-        std::vector< T > best;
+        Mailbox<T> *inbox; // by receiving pool
+        std::vector<size_t> age; // generations of each pool, over all runs
+#ifdef ARENA
+        Arena *arenas;     // two per pool, used by alternate generations
+#endif
         size_t npools, psize;
+        RunControl control;
+        Stopwatch clock;
+        volatile size_t generations; // of all pools
+        volatile int reason;         // RunControl::Reason
         //Plot plot;
 
 
         Population(size_t pool_size, size_t num_pools)
-                : npools(num_pools),
-                  psize(pool_size)
+                : inbox(new Mailbox<T>[num_pools]),
+                  age(num_pools, 0),
+#ifdef ARENA
+                  arenas(new Arena[2*num_pools]),
+#endif
+                  npools(num_pools),
+                  psize(pool_size),
+                  generations(0),
+                  reason(RunControl::RUNNING)
                   //, plot(400, 400, 10, -10, 10, -10)
         {
                 for (size_t i=0; i < num_pools; ++i) {
                         pools.push_back(Pool<T,Policy>(pool_size, i));
                         pools[i].randomize();
                         pools[i].sort();
-                        best.push_back(Policy::null());
                 }
         }
 
+        ~Population() {
+                drain();
+                delete[] inbox;
+                for (size_t i=0; i < npools; ++i)
+                        pools[i].clear();
+#ifdef ARENA
+                delete[] arenas;
+#endif
+        }
+
+        static void release_migrant(T &m) {
+#ifdef DEEP_COPY
+                Policy::release(m);
+#endif
+        }
+
+        // migrants not received by the end of a run
+        void drain() {
+                T m;
+                for (size_t i=0; i < npools; ++i)
+                        while (inbox[i].pop(m))
+                                release_migrant(m);
+        }
+
+        void stop(RunControl::Reason r) {
+                __sync_bool_compare_and_swap(&reason, RunControl::RUNNING, r);
+        }
+
+        bool running(size_t pool_generations) {
+                if (reason != RunControl::RUNNING)
+                        return false;
+                if (control.generations && pool_generations >= control.generations)
+                        return false;
+                if (control.seconds > 0 && clock.elapsed() >= control.seconds) {
+                        stop(RunControl::TIME);
+                        return false;
+                }
+                return true;
+        }
+
         struct Task {
                 Population *pop;
                 size_t pool_id;
@@ -89,54 +398,81 @@ struct Population {
 
                 void operator() (int &dummy) {
                         Pool<T,Policy> tmp(pop->psize, pool_id);
-                        size_t i=0,
-                               next_id = (pool_id+1)%(pop->npools),
-                               last_id = pop->pools[pool_id].pop.size()-1;
-
-                        T null_entry = Policy::null();
-                        while (true) {
-                                Policy::iterate(pop->pools[pool_id], tmp, pool_id);
+                        Pool<T,Policy> &p = pop->pools[pool_id];
+                        size_t &age = pop->age[pool_id],
+                               i=0,
+                               next_id = (pool_id+1)%(pop->npools);
+                        T migrant;
+                        while (pop->running(i)) {
+#ifdef ARENA
+                                {
+                                        Arena &arena = pop->arenas[2*pool_id + (age & 1)];
+                                        arena.clear();
+                                        ArenaScope scope(&arena);
+                                        Policy::iterate(p, tmp, pool_id);
+                                }
+#else
+                                Policy::iterate(p, tmp, pool_id);
+#endif
                                 i++;
-                                { Lock lock(pop->pools[pool_id].mutex);
-                                        // have a migrant
-                                        if (pop->best[pool_id] == null_entry) {
-                                                //LOG("import migrant(" << pool_id << "):" << Policy::error(pop->best[pool_id], pool_id));
-                                                // sort
-                                                pop->pools[pool_id].sort();
-                                                // delete worst
-                                                Policy::release(pop->pools[pool_id].pop[last_id]);
-                                                pop->pools[pool_id].pop[last_id] = Policy::null();
-                                                // set worst as the migrant
-                                                pop->pools[pool_id].pop[last_id] = pop->best[pool_id];
-                                                // set the migrant origin to null
-                                                pop->best[pool_id] = Policy::null();
-                                        }
-                                        // re-sort
-                                        pop->pools[pool_id].sort();
-                                        // if enough time passed
-                                        if ((i + (pool_id * (800 / (pop->npools)))) % 800 == 0) {
-                                                Lock lock(pop->pools[next_id].mutex);
-                                                //SLOG("migrate " << pool_id << " -> " << next_id);
+                                age++;
+                                __sync_fetch_and_add(&pop->generations, 1);
+
+                                // migrants replace the worst
+                                while (pop->inbox[pool_id].pop(migrant)) {
+                                        size_t w = p.worst();
+                                        Policy::release(p.pop[w]);
+                                        p.pop[w] = migrant;
+                                }
+                                p.order(ELITE);
+
+                                if (pop->control.has_target &&
+                                    Policy::fitness(p.pop[0], pool_id) <= pop->control.target)
+                                        pop->stop(RunControl::TARGET);
+
+                                // if enough time passed
+                                if ((i + (pool_id * (MIGRATION / (pop->npools)))) % MIGRATION == 0) {
+                                        //SLOG("migrate " << pool_id << " -> " << next_id);
 #ifdef DEEP_COPY
-                                                pop->best[next_id] = pop->pools[pool_id].pop[0]->deep_copy();
+                                        ArenaScope heap(0);
+                                        migrant = p.pop[0]->deep_copy();
 #else
-                                                pop->best[next_id] = pop->pools[pool_id].pop[0];
+                                        migrant = p.pop[0];
 #endif
-                                                Policy::set_pool(pop->best[next_id], next_id);
-                                        }
+                                        Policy::set_pool(migrant, next_id);
+                                        // the receiver has not kept up: drop it
+                                        if (!pop->inbox[next_id].push(migrant))
+                                                release_migrant(migrant);
                                 }
                         }
                 }
         };
 
-        void iterate() {
+        // runs the pools until control says to stop, returns why
+        RunControl::Reason run(const RunControl &c) {
+                control = c;
+                reason = RunControl::RUNNING;
+                generations = 0;
+                clock.reset();
+
                 TaskPool<Task> tasks(npools);
                 for (size_t i=0; i < npools; ++i) {
                         Task t(this, i);
                         tasks.push(t);
                 }
                 tasks.run();
+                drain();
+
+                stop(RunControl::GENERATIONS);
+                return (RunControl::Reason) reason;
         }
+
+        // runs forever
+        void iterate() { run(RunControl()); }
+
+private:
+        Population(const Population &);
+        Population& operator=(const Population &);
 };
 
 
@@ -35,6 +35,7 @@ struct Human {
         void next(Color c, S &state) {
                 bool done=false, parsed=false;
                 typename S::M m;
+                log_flush();
                 while (!done) {
                         cout << "move> ";
 
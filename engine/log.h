@@ -0,0 +1,264 @@
+#ifndef LOG_H
+#define LOG_H
+#pragma once
+
+// included by common.h, after TIMER
+
+#include <pthread.h>
+#include <unistd.h>
+#include <streambuf>
+#include <vector>
+#include <algorithm>
+
+//-----------------------------------------------------------------------------
+//
+// Logging
+//
+// LOG(x) formats x on the calling thread into a line buffer of its own and
+// copies it, with a microsecond timestamp, into the thread's ring; a
+// background thread drains all rings every millisecond, merges the lines by
+// timestamp and writes them to cout. A search thread never takes a lock or
+// waits for output: when its ring is full the line is dropped and counted,
+// and the drain thread reports the count. Lines longer than LOG_LINE are cut.
+//
+// Levels are chosen at compile time with LOG_LEVEL: LOG is LOG_INFO, DEBUG
+// is LOG_DEBUG (e.g. every candidate move) and compiles to nothing unless
+// LOG_LEVEL is LOG_DEBUG; LOG_LEVEL=LOG_NONE removes LOG as well. DIE
+// always prints.
+//
+// Everything still buffered is written by log_flush(), which runs at exit
+// and before DIE; code that prompts on cout (e.g. Human) calls it first.
+// Output since the last drain is lost on a crash, so define SYNC_LOG to
+// write each line straight to cout instead, as before.
+//
+//-----------------------------------------------------------------------------
+
+#define LOG_NONE  0
+#define LOG_INFO  1
+#define LOG_DEBUG 2
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_INFO
+#endif
+
+static const size_t LOG_LINE = 1024,
+                    LOG_RING = 1 << 16; // bytes, a power of two
+
+static inline uint64_t log_clock() {
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        return uint64_t(now.tv_sec) * 1000000 + now.tv_usec;
+}
+
+// formats into a fixed buffer, cutting what does not fit; the characters
+// cut are dropped rather than failed, so the stream stays good
+struct LogLine : std::streambuf {
+        char data[LOG_LINE];
+        LogLine() { reset(); }
+        void reset() { setp(data, data + LOG_LINE); }
+        size_t size() const { return pptr() - pbase(); }
+        int_type overflow(int_type c) { return traits_type::not_eof(c); }
+};
+
+//-----------------------------------------------------------------------------
+//
+// LogRing
+//
+// Single producer (the owning thread) and single consumer (the drain
+// thread). A record is its timestamp, its length and its text, each field
+// copied byte by byte around the end of the buffer. A ring outlives its
+// thread: when the thread exits the ring is marked free, and a new thread
+// takes it over once the drain thread has emptied it.
+//
+//-----------------------------------------------------------------------------
+
+struct LogRing {
+        char buf[LOG_RING];
+        volatile size_t head, tail; // written by producer, consumer
+        volatile int owned;
+        volatile size_t dropped;
+        LogRing *next;
+        LogLine line;
+        std::ostream out;
+
+        LogRing() : head(0), tail(0), owned(1), dropped(0), next(0), out(&line) {}
+
+        void copy_in(size_t at, const void *p, size_t n) {
+                const char *c = (const char *) p;
+                for (size_t i=0; i < n; ++i)
+                        buf[(at + i) & (LOG_RING-1)] = c[i];
+        }
+
+        void copy_out(size_t at, void *p, size_t n) const {
+                char *c = (char *) p;
+                for (size_t i=0; i < n; ++i)
+                        c[i] = buf[(at + i) & (LOG_RING-1)];
+        }
+
+        void push(uint64_t ts) {
+                uint32_t n = line.size();
+                size_t need = sizeof(ts) + sizeof(n) + n;
+                if (head + need - tail > LOG_RING) {
+                        __sync_fetch_and_add(&dropped, 1);
+                        return;
+                }
+                copy_in(head, &ts, sizeof(ts));
+                copy_in(head + sizeof(ts), &n, sizeof(n));
+                copy_in(head + sizeof(ts) + sizeof(n), line.data, n);
+                __sync_synchronize();
+                head += need;
+        }
+
+        bool empty() const { return head == tail; }
+
+        // the next record, if any
+        bool pop(uint64_t &ts, std::string &s) {
+                if (empty())
+                        return false;
+                __sync_synchronize();
+                uint32_t n;
+                copy_out(tail, &ts, sizeof(ts));
+                copy_out(tail + sizeof(ts), &n, sizeof(n));
+                s.resize(n);
+                if (n)
+                        copy_out(tail + sizeof(ts) + sizeof(n), &s[0], n);
+                __sync_synchronize();
+                tail += sizeof(ts) + sizeof(n) + n;
+                return true;
+        }
+};
+
+//-----------------------------------------------------------------------------
+//
+// Drain thread
+//
+//-----------------------------------------------------------------------------
+
+struct LogRecord {
+        uint64_t ts;
+        size_t seq; // keeps a thread's lines in order on equal timestamps
+        std::string text;
+        bool operator < (const LogRecord &r) const {
+                return ts != r.ts ? ts < r.ts : seq < r.seq;
+        }
+};
+
+struct Logger {
+        LogRing *volatile rings;
+        pthread_key_t key;
+        pthread_t thread;
+        pthread_mutex_t drain_mutex;
+        volatile int stopped;
+        uint64_t start;
+        std::vector<LogRecord> records;
+
+        // never destroyed, so lines logged during exit still have a ring
+        static Logger &get() {
+                static Logger *logger = new Logger;
+                return *logger;
+        }
+
+        static void release(void *ring) {
+                ((LogRing *) ring)->owned = 0;
+        }
+
+        static void *spawn_thread(void *self) {
+                ((Logger *) self)->loop();
+                return NULL;
+        }
+
+        static void at_exit() { get().stop(); }
+
+        Logger() : rings(0), stopped(0), start(uint64_t(TIMER.timestamp) * 1000000) {
+                pthread_key_create(&key, release);
+                pthread_mutex_init(&drain_mutex, NULL);
+                pthread_create(&thread, NULL, spawn_thread, this);
+                atexit(at_exit);
+        }
+
+        // this thread's ring: a free one from the list, or a new one
+        LogRing &ring() {
+                LogRing *r = (LogRing *) pthread_getspecific(key);
+                if (r)
+                        return *r;
+                for (r = rings; r; r = r->next)
+                        if (!r->owned && r->empty() && __sync_bool_compare_and_swap(&r->owned, 0, 1))
+                                break;
+                if (!r) {
+                        r = new LogRing;
+                        do {
+                                r->next = rings;
+                        } while (!__sync_bool_compare_and_swap(&rings, r->next, r));
+                }
+                pthread_setspecific(key, r);
+                return *r;
+        }
+
+        void write(uint64_t ts, const char *s, size_t n) {
+                cout << '[' << (ts - start) / 1000000 << "] ";
+                cout.write(s, n);
+                cout << '\n';
+        }
+
+        // writes everything buffered, in timestamp order
+        void drain() {
+                pthread_mutex_lock(&drain_mutex);
+                records.clear();
+                size_t seq = 0, dropped = 0;
+                for (LogRing *r = rings; r; r = r->next) {
+                        LogRecord rec;
+                        while (r->pop(rec.ts, rec.text)) {
+                                rec.seq = seq++;
+                                records.push_back(rec);
+                        }
+                        if (r->dropped) {
+                                dropped += r->dropped;
+                                __sync_fetch_and_sub(&r->dropped, r->dropped);
+                        }
+                }
+                std::stable_sort(records.begin(), records.end());
+                for (size_t i=0; i < records.size(); ++i)
+                        write(records[i].ts, records[i].text.data(), records[i].text.size());
+                if (dropped)
+                        cout << "[log] " << dropped << " lines dropped" << '\n';
+                if (!records.empty() || dropped)
+                        cout << flush;
+                pthread_mutex_unlock(&drain_mutex);
+        }
+
+        void loop() {
+                while (!stopped) {
+                        drain();
+                        usleep(1000);
+                }
+        }
+
+        void stop() {
+                if (__sync_lock_test_and_set(&stopped, 1))
+                        return;
+                pthread_join(thread, NULL);
+                drain();
+        }
+};
+
+static inline void log_flush() {
+#ifndef SYNC_LOG
+        Logger::get().drain();
+#endif
+        cout << flush;
+}
+
+#ifdef SYNC_LOG
+#define LOG_WRITE(x)  { cout << '[' << TIMER.elapsed() << "] " << x << endl << flush; }
+#else
+// after the drain thread has stopped (at exit), lines are written directly
+#define LOG_WRITE(x)  { Logger &_lg = Logger::get(); \
+                        LogRing &_lr = _lg.ring(); \
+                        _lr.line.reset(); \
+                        _lr.out.clear(); \
+                        _lr.out << x; \
+                        _lr.push(log_clock()); \
+                        if (_lg.stopped) _lg.drain(); }
+#endif
+
+#endif // LOG_H
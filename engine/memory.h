@@ -4,6 +4,10 @@
 
 #include "common.h"
 
+#include <stdlib.h>
+#include <new>
+#include <vector>
+
 template <typename T>
 struct MemoryPool {
         size_t counter;
@@ -28,6 +32,120 @@ struct MemoryPool {
         }
 
         void clear() { counter = 0; }
+
+        // drops everything allocated; the new size is allocated on demand
+        void resize(size_t s) {
+                if (s == size)
+                        return;
+                delete[] data;
+                data = 0;
+                counter = 0;
+                size = s;
+        }
+
+private:
+        MemoryPool(const MemoryPool &);
+        MemoryPool& operator=(const MemoryPool &);
+};
+
+//-----------------------------------------------------------------------------
+//
+// Arena
+//
+// Bump allocator over a list of CHUNK byte blocks. Objects are not freed one
+// at a time: clear() drops everything allocated so far and keeps the blocks
+// for reuse, so once warmed up an arena does no malloc at all. Not thread
+// safe; each thread selects its own with ArenaScope.
+//
+//-----------------------------------------------------------------------------
+
+struct Arena {
+        enum { CHUNK = 64 * 1024, ALIGN = 16 };
+
+        std::vector<char *> chunks;
+        size_t chunk, // current block
+               used,  // bytes used in it
+               total; // bytes handed out since clear()
+
+        Arena() : chunk(0), used(0), total(0) {
+                chunks.push_back(new_chunk());
+        }
+
+        ~Arena() {
+                for (size_t i=0; i < chunks.size(); ++i)
+                        free(chunks[i]);
+        }
+
+        static char *new_chunk() {
+                void *p = 0;
+                if (posix_memalign(&p, ALIGN, CHUNK) != 0)
+                        throw std::bad_alloc();
+                return (char *) p;
+        }
+
+        void *alloc(size_t bytes) {
+                bytes = (bytes + ALIGN-1) & ~size_t(ALIGN-1);
+                if (bytes > CHUNK)
+                        DIE("arena allocation of " << bytes << " bytes");
+                if (used + bytes > CHUNK) {
+                        if (++chunk == chunks.size())
+                                chunks.push_back(new_chunk());
+                        used = 0;
+                }
+                void *p = chunks[chunk] + used;
+                used += bytes;
+                total += bytes;
+                return p;
+        }
+
+        void clear() { chunk = used = total = 0; }
+        size_t size() const { return total; }
+        size_t capacity() const { return chunks.size() * CHUNK; }
+
+private:
+        Arena(const Arena &);
+        Arena& operator=(const Arena &);
+};
+
+// the arena new ArenaObjects of the calling thread come from, 0 for the heap
+static inline Arena *&thread_arena() {
+        static __thread Arena *arena = 0;
+        return arena;
+}
+
+struct ArenaScope {
+        Arena *saved;
+        ArenaScope(Arena *a) : saved(thread_arena()) { thread_arena() = a; }
+        ~ArenaScope() { thread_arena() = saved; }
+};
+
+// Base for types allocated with new from the thread's arena when one is
+// selected, and from the heap otherwise. A header records which, so delete
+// frees heap instances and leaves arena instances to Arena::clear().
+struct ArenaObject {
+        union Header {
+                Arena *arena;
+                long double align;
+        };
+
+        static void *operator new(size_t bytes) {
+                Arena *a = thread_arena();
+                Header *h = (Header *) (a ? a->alloc(sizeof(Header) + bytes)
+                                          : malloc(sizeof(Header) + bytes));
+                if (!h)
+                        throw std::bad_alloc();
+                h->arena = a;
+                return h + 1;
+        }
+
+        static void operator delete(void *p) {
+                if (p && !from_arena(p))
+                        free((Header *) p - 1);
+        }
+
+        static bool from_arena(const void *p) {
+                return ((const Header *) p - 1)->arena != 0;
+        }
 };
 
 #endif // MEMORY_H
@@ -3,6 +3,7 @@
 #pragma once
 
 #include "common.h"
+#include "stats.h"
 
 
 template <typename S>
@@ -15,11 +16,13 @@ struct Minimax {
         }
 
         int search(S &state, int depth, bool maximise) {
+                STATS_INC(nodes);
                 if (state.game_over() || (depth == 0))
                         return state.score(maximise);
 
                 MoveList ml;
                 state.moves(ml);
+                STATS_INC(movegen);
                 S child;
 
                 if (!maximise) {
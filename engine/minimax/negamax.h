@@ -3,6 +3,7 @@
 #pragma once
 
 #include "common.h"
+#include "stats.h"
 
 template <typename S>
 struct Negamax {
@@ -14,11 +15,13 @@ struct Negamax {
         }
 
         int search(S &state, int depth, bool maximise) {
+                STATS_INC(nodes);
                 if (state.game_over() || (depth == 0))
                         return maximise ? state.score(maximise) : -state.score(maximise);
 
                 MoveList ml;
                 state.moves(ml);
+                STATS_INC(movegen);
                 S child;
 
                 int alpha = numeric_limits<int>::min();
@@ -5,6 +5,7 @@
 #include "common.h"
 #include "sort.h"
 #include "thread.h"
+#include "stats.h"
 
 #include <queue>
 
@@ -27,11 +28,13 @@ struct Negascout {
         }
 
         int pvs(S &state, int alpha, int beta, int depth, bool maximise) {
+                STATS_INC(nodes);
                 if (state.game_over() || (depth == 0))
                         return maximise ? state.score(maximise) : -state.score(maximise);
 
                 MoveList ml;
                 state.moves(ml);
+                STATS_INC(movegen);
 
                 // build sort list
                 S children[ml.size()];
@@ -60,8 +63,10 @@ struct Negascout {
                         alpha = std::max(alpha, result);
 
                         // beta cutoff
-                        if (alpha >= beta)
+                        if (alpha >= beta) {
+                                STATS_INC(cutoffs);
                                 return alpha;
+                        }
 
                         // set new null window
                         b = alpha+1;
@@ -2,6 +2,8 @@
 #define STRATEGY_H
 
 #include "thread.h"
+#include "stats.h"
+#include "ponder.h"
 
 template <typename S, typename A, size_t D>
 struct BasicMinimax {
@@ -9,10 +11,26 @@ struct BasicMinimax {
 
         bool parallel;
         MoveList global_ml;
-
-        BasicMinimax() : parallel(true)
+#ifdef STATS
+        SearchStats stats; // of the last move
+        Mutex mutex;
+#endif
+
+        // pondering (see ponder.h): for each of the opponent's replies to
+        // our move, in turn, the scores of our moves after it, in move
+        // order; next() searches only the moves not scored yet
+        Ponder ponder;
+        bool ponder_on;
+        Color ponder_color;
+        S ponder_state;
+        MoveList ponder_ml;
+        vector<vector<int> > ponder_scores;
+
+        BasicMinimax() : parallel(true), ponder_on(false)
         {}
 
+        ~BasicMinimax() { ponder.stop(); }
+
         struct Result {
                 size_t index;
                 int score;
@@ -25,20 +43,24 @@ struct BasicMinimax {
                 bool maximise;
 
                 void operator() (Result &result) {
-                        A algo;
-                        int score = algo.search(
-                                        child,
-                                        D,
-                                        !maximise);
-
-                        if (!maximise)
-                                score = -score;
-
                         result.index = index;
-                        result.score = score;
+                        result.score = search_child(child, maximise);
+                        STATS_GATHER(parent->stats, parent->mutex);
                 }
         };
 
+        static int search_child(S &child, bool maximise) {
+                A algo;
+                int score = algo.search(
+                                child,
+                                D,
+                                !maximise);
+
+                if (!maximise)
+                        score = -score;
+                return score;
+        }
+
         void next(Color c, S &state) {
 
                 bool maximise = (c == BLACK);
@@ -46,12 +68,33 @@ struct BasicMinimax {
                 int score = maximise ? numeric_limits<int>::min()
                                      : numeric_limits<int>::max();
 
+                const vector<int> *known = ponder_reuse(c, state);
+
                 global_ml.clear();
                 state.moves(global_ml);
+                STATS_ONLY(stats.clear();)
+                STATS_INC(movegen);
 
-                int best = parallel
-                        ? async_search(state, maximise, score)
-                        : sync_search(state, maximise, score);
+                int best = -1;
+                size_t from = 0;
+                if (known) {
+                        for (; from < known->size() && from < global_ml.size(); ++from) {
+                                int s = (*known)[from];
+                                if ((maximise && s > score) || (!maximise && s < score))
+                                        score = s, best = from;
+                        }
+                        DEBUG("ponder: reusing " << from << " of " << global_ml.size() << " scores");
+                }
+
+                int found = parallel
+                        ? async_search(state, maximise, score, from)
+                        : sync_search(state, maximise, score, from);
+                if (found != -1)
+                        best = found;
+
+                STATS_GATHER(stats, mutex);
+                STATS_ONLY(stats.max_depth = D;)
+                STATS_END_MOVE(stats, "minimax");
 
                 if (global_ml.size() > 0) {
                         if (best == -1)
@@ -60,12 +103,18 @@ struct BasicMinimax {
                         state.announce(global_ml[best]);
                         state.move(global_ml[best]);
                 }
+
+                // pondering scores children as async_search does
+                if (ponder_on && parallel && !state.game_over())
+                        ponder_start(c, state);
         }
 
-        int async_search(S &state, bool maximise, int score) {
+        // the index of the best of our moves from `from` on, if any is better
+        // than score, or -1
+        int async_search(S &state, bool maximise, int score, size_t from=0) {
                 TaskPool<Task,Result> tasks(NUM_THREADS);
 
-                for (size_t i=0; i < global_ml.size(); ++i) {
+                for (size_t i=from; i < global_ml.size(); ++i) {
                         Task task;
 
                         task.parent = this;
@@ -80,22 +129,22 @@ struct BasicMinimax {
 
                 int best = -1;
 
-                for (size_t i=0; i < global_ml.size(); ++i) {
-                        int s = tasks[i].score;
+                for (size_t i=from; i < global_ml.size(); ++i) {
+                        int s = tasks[i-from].score;
                         if ((maximise && s > score) || (!maximise && s < score))
-                                score = s, best = tasks[i].index;
+                                score = s, best = tasks[i-from].index;
                 }
 
                 return best;
         }
 
 
-        int sync_search(S &state, bool maximise, int score) {
+        int sync_search(S &state, bool maximise, int score, size_t from=0) {
                 A algo;
 
                 int best = -1;
 
-                for (size_t i=0; i < global_ml.size(); ++i) {
+                for (size_t i=from; i < global_ml.size(); ++i) {
                         S child;
                         make_child(state, child, i);
                         int s = algo.search(child,
@@ -114,6 +163,76 @@ struct BasicMinimax {
                 child.move(global_ml[i]);
         }
 
+        // searches the opponent's turn
+        void set_ponder(bool on) {
+                ponder.stop();
+                ponder_on = on;
+        }
+
+        void ponder_start(Color c, S &state) {
+                ponder_color = c;
+                ponder_state.copy_from(state);
+                ponder_ml.clear();
+                ponder_state.moves(ponder_ml);
+                // sized before the search starts, so each task fills its own
+                ponder_scores.assign(ponder_ml.size(), vector<int>());
+                ponder.start(this);
+        }
+
+        // one reply per task, scoring our moves after it one at a time
+        struct PonderTask {
+                BasicMinimax *parent;
+                size_t reply;
+
+                void operator() (int &dummy) {
+                        const Ponder &ponder = parent->ponder;
+                        if (ponder.stopped())
+                                return;
+                        S position;
+                        position.copy_from(parent->ponder_state);
+                        position.move(parent->ponder_ml[reply]);
+                        MoveList ml;
+                        position.moves(ml);
+                        bool maximise = (parent->ponder_color == BLACK);
+                        vector<int> &scores = parent->ponder_scores[reply];
+                        for (size_t i=0; i < ml.size() && !ponder.stopped(); ++i) {
+                                S child;
+                                child.copy_from(position);
+                                child.move(ml[i]);
+                                scores.push_back(search_child(child, maximise));
+                        }
+                }
+        };
+
+        void ponder_search() {
+                TaskPool<PonderTask> tasks(NUM_THREADS);
+                for (size_t i=0; i < ponder_ml.size(); ++i) {
+                        PonderTask task;
+                        task.parent = this;
+                        task.reply = i;
+                        tasks.push(task);
+                }
+                tasks.run();
+        }
+
+        // stops pondering; the scores found after the reply that led to
+        // state, or NULL
+        const vector<int> *ponder_reuse(Color c, S &state) {
+                if (!ponder.running)
+                        return NULL;
+                ponder.stop();
+                if (c != ponder_color)
+                        return NULL;
+                for (size_t i=0; i < ponder_ml.size(); ++i) {
+                        S s;
+                        s.copy_from(ponder_state);
+                        s.move(ponder_ml[i]);
+                        if (same_position(s, state))
+                                return &ponder_scores[i];
+                }
+                return NULL;
+        }
+
         void set_param(float p) {}
 };
 
@@ -5,6 +5,7 @@
 #include "common.h"
 #include "sort.h"
 #include "thread.h"
+#include "stats.h"
 
 #include <queue>
 
@@ -43,14 +44,16 @@ struct MCMoveCounter {
                         s.set_index(m, result);
                 }
 
+#if LOG_LEVEL >= LOG_DEBUG
                 if (sum > 0) {
                         M tmp;
                         for (size_t i=0; i < MAX_MOVES; ++i) {
                                 s.set_index(tmp, i);
                                 if (count[i] > 0)
-                                        LOG("i=" << i << " score=" << ((float) count[i] / (float) sum) << " move=" << tmp.str());
+                                        DEBUG("i=" << i << " score=" << ((float) count[i] / (float) sum) << " move=" << tmp.str());
                         }
                 }
+#endif
                 return found;
         }
 };
@@ -65,6 +68,9 @@ struct MonteCarlo {
         C wins, win_first;
         float result[MAX_MOVES];
         Mutex mutex;
+#ifdef STATS
+        SearchStats stats; // of the last move
+#endif
 
         void play(Color c, S &s) {
                 M r;
@@ -73,6 +79,7 @@ struct MonteCarlo {
                 tmp.reset();
                 bool first = true;
                 size_t index=0;
+                STATS_INC(playouts);
                 while (!s.game_over()) {
                         if (!s.random_move(dummy, r))
                                 break;
@@ -84,6 +91,7 @@ struct MonteCarlo {
                         }
                         tmp.add(s, r);
                         s.move(r);
+                        STATS_INC(rollout_moves);
                 }
 
                 Lock lock(mutex);
@@ -103,6 +111,7 @@ struct MonteCarlo {
                         s.copy_from(*orig);
                         for (size_t i=0; i < iter; ++i)
                                 mc->play(c, s);
+                        STATS_GATHER(mc->stats, mc->mutex);
                 }
         };
 
@@ -111,8 +120,10 @@ struct MonteCarlo {
                 ml.clear();
                 wins.reset();
                 win_first.reset();
+                STATS_ONLY(stats.clear();)
 
                 state.moves(ml);
+                STATS_INC(movegen);
                 if (!ml.size())
                         return;
 
@@ -128,6 +139,9 @@ struct MonteCarlo {
 
                 tasks.run();
 
+                STATS_GATHER(stats, mutex);
+                STATS_END_MOVE(stats, "montecarlo");
+
                 M best;
                 //LOG("win total");
                 //wins.best(state, best);
@@ -3,6 +3,7 @@
 
 #include "common.h"
 #include "thread.h"
+#include "simd.h"
 
 #include <armadillo>
 
@@ -26,39 +27,46 @@ static inline double cross_entropy(double y, double t) {
 //-----------------------------------------------------------------------------------
 
 struct Sigmoid {
-	static inline arma::mat activation(arma::mat x) {
+	static inline arma::mat activation(const arma::mat &x) {
 		return 1/(1+exp(-x));
 	}
 
-	static inline arma::mat derivative(arma::mat x) {
+	static inline arma::mat derivative(const arma::mat &x) {
 		return x%(1-x);
 	}
+
+	static inline float activation(float x) { return 1/(1+expf(-x)); }
 };
 
 struct Tanh {
-	static inline arma::mat activation(arma::mat x) {
+	static inline arma::mat activation(const arma::mat &x) {
                 //return 2 / (1 + arma::exp(-2 * x)) - 1;
                 return arma::tanh(x);
 	}
 
-	static inline arma::mat derivative(arma::mat x) {
+	static inline arma::mat derivative(const arma::mat &x) {
                 return 1-arma::square(x);
 	}
+
+	static inline float activation(float x) { return tanhf(x); }
 };
 
 struct Softplus {
-	static inline arma::mat activation(arma::mat x) {
+	static inline arma::mat activation(const arma::mat &x) {
                 return arma::log(1+exp(x));
 	}
 
-	static inline arma::mat derivative(arma::mat x) {
+	static inline arma::mat derivative(const arma::mat &x) {
 		return 1/(1+exp(-x));
 	}
+
+	static inline float activation(float x) { return log1pf(expf(x)); }
 };
 
 struct Linear {
-	static inline arma::mat activation(arma::mat x) { return x; }
-	static inline arma::mat derivative(arma::mat x) { return x.ones(); }
+	static inline arma::mat activation(const arma::mat &x) { return x; }
+	static inline arma::mat derivative(const arma::mat &x) { return arma::ones(x.n_rows, x.n_cols); }
+	static inline float activation(float x) { return x; }
 };
 
 
@@ -107,6 +115,14 @@ public:
                   dw1_last, // previous weight changes
                   dw2_last;
 
+        // single precision copy of the weights for inference, see compile()
+        enum { HIDDEN_STRIDE = SIMD_PAD(NUM_HIDDEN) };
+
+        AlignedBuffer<float> fw1, // (NUM_INPUT+1) rows of HIDDEN_STRIDE, bias last
+                             fw2; // NUM_OUTPUT rows of HIDDEN_STRIDE
+        float fb2[NUM_OUTPUT];
+        bool compiled;
+
 
 	//---------------------------------------------------------------------------
 	//
@@ -118,7 +134,10 @@ public:
                   w1(NUM_INPUT+1, NUM_HIDDEN),
                   w2(NUM_HIDDEN+1, NUM_OUTPUT),
                   dw1_last(NUM_INPUT+1, NUM_HIDDEN),
-                  dw2_last(NUM_HIDDEN+1, NUM_OUTPUT)
+                  dw2_last(NUM_HIDDEN+1, NUM_OUTPUT),
+                  fw1((NUM_INPUT+1) * HIDDEN_STRIDE),
+                  fw2(NUM_OUTPUT * HIDDEN_STRIDE),
+                  compiled(false)
         {
                 reset();
         }
@@ -136,6 +155,7 @@ public:
 
                 randomize(w1);
                 randomize(w2);
+                compiled = false;
         }
 
 
@@ -147,10 +167,73 @@ public:
 
         void fprop(Query &q) const {
                 q.set_bias();
-                q.hidden = arma::join_rows(
-                                FH::activation(q.input * w1),
-                                arma::ones(q.input.n_rows, 1));
-                q.output = FO::activation(q.hidden * w2);
+                fprop(q.input, q.hidden, q.output);
+        }
+
+        // input must already hold the bias column
+        void fprop(const arma::mat &input, arma::mat &hidden, arma::mat &output) const {
+                hidden = arma::join_rows(
+                                FH::activation(input * w1),
+                                arma::ones(input.n_rows, 1));
+                output = FO::activation(hidden * w2);
+        }
+
+
+	//---------------------------------------------------------------------------
+	//
+	// Single precision inference
+	//
+	// Evaluates one input vector of NUM_INPUT floats (no bias entry) without
+	// touching the heap. The hidden layer is built by adding the weight row of
+	// every non-zero input to the bias row, so sparse inputs such as board
+	// positions only pay for their occupied cells. compile() must be called
+	// after the weights change; training clears the flag.
+	//
+	//---------------------------------------------------------------------------
+
+        void compile() {
+                fw1.clear();
+                fw2.clear();
+                for (size_t i=0; i <= NUM_INPUT; ++i)
+                        for (size_t j=0; j < NUM_HIDDEN; ++j)
+                                fw1[i*HIDDEN_STRIDE + j] = w1(i, j);
+                for (size_t k=0; k < NUM_OUTPUT; ++k) {
+                        for (size_t j=0; j < NUM_HIDDEN; ++j)
+                                fw2[k*HIDDEN_STRIDE + j] = w2(j, k);
+                        fb2[k] = w2(NUM_HIDDEN, k);
+                }
+                compiled = true;
+        }
+
+        // hidden pre-activations, HIDDEN_STRIDE floats aligned to SIMD_ALIGN
+        void fprop_hidden(const float *input, float *hidden) const {
+                assert(compiled);
+                memcpy(hidden, &fw1[NUM_INPUT*HIDDEN_STRIDE], HIDDEN_STRIDE*sizeof(float));
+                for (size_t i=0; i < NUM_INPUT; ++i)
+                        if (input[i] != 0)
+                                simd::axpy(input[i], &fw1[i*HIDDEN_STRIDE], hidden, HIDDEN_STRIDE);
+        }
+
+        // activates hidden in place and writes NUM_OUTPUT outputs
+        void fprop_output(float *hidden, float *output) const {
+                for (size_t j=0; j < NUM_HIDDEN; ++j)
+                        hidden[j] = FH::activation(hidden[j]);
+                for (size_t k=0; k < NUM_OUTPUT; ++k)
+                        output[k] = FO::activation(
+                                simd::dot(&fw2[k*HIDDEN_STRIDE], hidden, HIDDEN_STRIDE) + fb2[k]);
+        }
+
+        // adds delta times the w1 row of input i to hidden pre-activations,
+        // for updating them when only a few inputs change
+        void accumulate(float *hidden, size_t i, float delta) const {
+                assert(compiled);
+                simd::axpy(delta, &fw1[i*HIDDEN_STRIDE], hidden, HIDDEN_STRIDE);
+        }
+
+        void fprop(const float *input, float *output) const {
+                float hidden[HIDDEN_STRIDE] __attribute__((aligned(SIMD_ALIGN)));
+                fprop_hidden(input, hidden);
+                fprop_output(hidden, output);
         }
 
 
@@ -175,25 +258,64 @@ public:
                 return sse;
         }
 
+        // Trains on input and target without writing to them, so several
+        // nets can share one dataset. input must already hold the bias
+        // column. With a batch_size, each iteration is a pass of minibatch
+        // updates over consecutive rows.
+        double train_loop(const arma::mat &input, const arma::mat &target,
+                          double threshold, double learning_rate, size_t max,
+                          size_t batch_size=0) {
+                arma::mat in, t, hidden, output;
+                size_t n = input.n_rows;
+                if (batch_size == 0 || batch_size > n)
+                        batch_size = n;
+
+                double sse=10.0;
+                for (size_t i=0; i < max; ++i) {
+                        sse = 0;
+                        if (batch_size == n) {
+                                fprop(input, hidden, output);
+                                sse = backprop(input, hidden, output, target-output, learning_rate);
+                        } else {
+                                for (size_t first=0; first < n; first += batch_size) {
+                                        size_t last = std::min(n, first+batch_size) - 1;
+                                        in = input.rows(first, last);
+                                        t = target.rows(first, last);
+                                        fprop(in, hidden, output);
+                                        sse += backprop(in, hidden, output, t-output, learning_rate);
+                                }
+                        }
+                        if (sse < threshold)
+                                break;
+                }
+                return sse;
+        }
+
         double train_one(Query &q, double learning_rate) {
                 fprop(q);
                 return backprop(q, q.target-q.output, learning_rate);
         }
 
-        double backprop(Query &q, arma::mat error, double learning_rate) {
+        double backprop(Query &q, const arma::mat &error, double learning_rate) {
+                return backprop(q.input, q.hidden, q.output, error, learning_rate);
+        }
+
+        double backprop(const arma::mat &input, const arma::mat &hidden, const arma::mat &output,
+                        const arma::mat &error, double learning_rate) {
                 arma::mat dw1, dw2, deltas_hid, deltas_out;
 
-                deltas_out = error % FO::derivative(q.output);
-                deltas_hid = (deltas_out * w2.t()) % FH::derivative(q.hidden);
+                deltas_out = error % FO::derivative(output);
+                deltas_hid = (deltas_out * w2.t()) % FH::derivative(hidden);
 
-                dw1 = q.input.t() * deltas_hid.cols(0, deltas_hid.n_cols-2);
-                dw2 = q.hidden.t() * deltas_out;
+                dw1 = input.t() * deltas_hid.cols(0, deltas_hid.n_cols-2);
+                dw2 = hidden.t() * deltas_out;
 
                 w1 += momentum * dw1_last + learning_rate * dw1;
                 w2 += momentum * dw2_last + learning_rate * dw2;
 
                 dw1_last = dw1;
                 dw2_last = dw2;
+                compiled = false;
 
                 return arma::trace(error.t()*error);
         }
@@ -216,40 +338,49 @@ struct EnsembleFFNet {
         NN net[NUM_NN];
         double momentum;
 
-        struct Task {
-                EnsembleFFNet *n;
-                size_t idx;
-                Query q;
-                double threshold;
-                double learning_rate;
-                size_t max;
-                double momentum;
-
-                void operator() (double &result) {
-                        n->net[idx].momentum = momentum;
-                        result = n->net[idx].train_loop(q, threshold, learning_rate, max);
-                }
-        };
+        // all members side by side, see stack()
+        arma::mat stacked_w1, // (NUM_INPUT+1) x (NUM_NN*NUM_HIDDEN)
+                  stacked_w2; // (NUM_NN*NUM_HIDDEN+1) x (NUM_NN*NUM_OUTPUT), block diagonal
 
+        EnsembleFFNet() : momentum(0.3) {
+                stack();
+        }
 
-        double train_loop(Query &q, double threshold, double learning_rate, size_t max) {
-                TaskPool<Task,double> tasks(NUM_NN);
-                for (size_t i=0; i < NUM_NN; ++i) {
-                        Task t;
-                        t.n = this;
-                        t.idx = i;
-                        t.q = q;
-                        t.threshold = threshold;
-                        t.learning_rate = learning_rate;
-                        t.max = max;
-                        t.momentum = momentum;
-                        tasks.push(t);
+        // Members train in parallel on the shared thread pool. They all read
+        // the same input and target, which is not copied; each keeps its own
+        // activations.
+        struct TrainJob : ThreadPool::Job {
+                EnsembleFFNet *n;
+                const Query *q;
+                double threshold, learning_rate;
+                size_t max, batch_size;
+                double sse[NUM_NN];
+
+                void operator() (size_t i) {
+                        sse[i] = n->net[i].train_loop(q->input, q->target,
+                                        threshold, learning_rate, max, batch_size);
                 }
+        };
 
-                tasks.run();
+        double train_loop(Query &q, double threshold, double learning_rate, size_t max,
+                          size_t batch_size=0) {
+                q.set_bias();
+                for (size_t i=0; i < NUM_NN; ++i)
+                        net[i].momentum = momentum;
+
+                TrainJob job;
+                job.n = this;
+                job.q = &q;
+                job.threshold = threshold;
+                job.learning_rate = learning_rate;
+                job.max = max;
+                job.batch_size = batch_size;
+                thread_pool().run(job, NUM_NN);
+
+                stack();
                 double mse = 0;
                 for (size_t i=0; i < NUM_NN; ++i)
-                        mse += tasks[i];
+                        mse += job.sse[i];
                 return mse / double(NUM_NN);
         }
 
@@ -257,19 +388,57 @@ struct EnsembleFFNet {
                 double mse = 0;
                 for (size_t i=0; i < NUM_NN; ++i)
                         mse += net[i].train_one(query, learning_rate);
+                stack();
                 return mse / double(NUM_NN);
         }
 
-        void fprop(Query &q) const {
-                q.output = arma::zeros(q.input.n_rows, NUM_OUTPUT);
-                Query p;
-                p = q;
+        // Rebuilds the stacked weights from the members, so fprop() runs
+        // one GEMM per layer for the whole ensemble. Needed after training
+        // a member directly.
+        void stack() {
+                stacked_w1.set_size(NUM_INPUT+1, NUM_NN*NUM_HIDDEN);
+                stacked_w2.zeros(NUM_NN*NUM_HIDDEN+1, NUM_NN*NUM_OUTPUT);
                 for (size_t i=0; i < NUM_NN; ++i) {
-                        net[i].fprop(p);
-                        q.output += p.output;
+                        stacked_w1.cols(i*NUM_HIDDEN, (i+1)*NUM_HIDDEN-1) = net[i].w1;
+                        stacked_w2.submat(i*NUM_HIDDEN, i*NUM_OUTPUT,
+                                          (i+1)*NUM_HIDDEN-1, (i+1)*NUM_OUTPUT-1)
+                                = net[i].w2.rows(0, NUM_HIDDEN-1);
+                        stacked_w2.submat(NUM_NN*NUM_HIDDEN, i*NUM_OUTPUT,
+                                          NUM_NN*NUM_HIDDEN, (i+1)*NUM_OUTPUT-1)
+                                = net[i].w2.row(NUM_HIDDEN);
                 }
+        }
+
+        void fprop(Query &q) const {
+                q.set_bias();
+                q.hidden = arma::join_rows(
+                                FH::activation(q.input * stacked_w1),
+                                arma::ones(q.input.n_rows, 1));
+                arma::mat all = FO::activation(q.hidden * stacked_w2);
+
+                q.output = all.cols(0, NUM_OUTPUT-1);
+                for (size_t i=1; i < NUM_NN; ++i)
+                        q.output += all.cols(i*NUM_OUTPUT, (i+1)*NUM_OUTPUT-1);
                 q.output /= double(NUM_NN);
         }
+
+        void compile() {
+                for (size_t i=0; i < NUM_NN; ++i)
+                        net[i].compile();
+        }
+
+        void fprop(const float *input, float *output) const {
+                float o[NUM_OUTPUT];
+                for (size_t k=0; k < NUM_OUTPUT; ++k)
+                        output[k] = 0;
+                for (size_t i=0; i < NUM_NN; ++i) {
+                        net[i].fprop(input, o);
+                        for (size_t k=0; k < NUM_OUTPUT; ++k)
+                                output[k] += o[k];
+                }
+                for (size_t k=0; k < NUM_OUTPUT; ++k)
+                        output[k] /= float(NUM_NN);
+        }
 };
 
 #endif // GGP_NEURAL_H
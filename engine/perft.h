@@ -0,0 +1,98 @@
+#ifndef PERFT_H
+#define PERFT_H
+#pragma once
+
+#include "common.h"
+#include "thread.h"
+
+//-----------------------------------------------------------------------------
+//
+// Perft
+//
+// Counts the leaf nodes of the full game tree to a fixed depth. Comparing the
+// counts against known values validates a move generator, and timing them
+// measures it. The root moves are split across threads.
+//
+//-----------------------------------------------------------------------------
+
+template <typename S>
+struct Perft {
+        typedef typename S::ML ML;
+
+        struct Result {
+                uint64_t nodes;
+                double seconds;
+
+                Result() : nodes(0), seconds(0) {}
+                double nps() const { return seconds > 0 ? double(nodes) / seconds : 0; }
+        };
+
+        static uint64_t count(S &state, size_t depth) {
+                if (depth == 0)
+                        return 1;
+                if (state.game_over())
+                        return 0;
+
+                ML ml;
+                state.moves(ml);
+
+                // bulk count the last ply
+                if (depth == 1)
+                        return ml.size();
+
+                uint64_t nodes = 0;
+                S child;
+                for (size_t i=0; i < ml.size(); ++i) {
+                        child.copy_from(state);
+                        child.move(ml[i]);
+                        nodes += count(child, depth-1);
+                }
+                return nodes;
+        }
+
+        struct Task {
+                S *root;
+                ML *ml;
+                size_t index, depth;
+
+                void operator() (uint64_t &nodes) {
+                        S child;
+                        child.copy_from(*root);
+                        child.move((*ml)[index]);
+                        nodes = count(child, depth-1);
+                }
+        };
+
+        static Result run(S &state, size_t depth, size_t num_threads=NUM_THREADS) {
+                Result r;
+                Stopwatch sw;
+
+                if (depth < 2 || state.game_over() || num_threads < 2) {
+                        r.nodes = count(state, depth);
+                        r.seconds = sw.elapsed();
+                        return r;
+                }
+
+                ML ml;
+                state.moves(ml);
+
+                TaskPool<Task,uint64_t> tasks(num_threads);
+                for (size_t i=0; i < ml.size(); ++i) {
+                        Task task;
+                        task.root = &state;
+                        task.ml = &ml;
+                        task.index = i;
+                        task.depth = depth;
+                        tasks.push(task);
+                }
+
+                tasks.run();
+
+                for (size_t i=0; i < ml.size(); ++i)
+                        r.nodes += tasks[i];
+                r.seconds = sw.elapsed();
+                return r;
+        }
+};
+
+#endif // PERFT_H
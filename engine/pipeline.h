@@ -0,0 +1,262 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+#pragma once
+
+#include "common.h"
+#include "record.h"
+
+#pragma pack(push)
+#pragma pack()
+#include <armadillo>
+
+#include <vector>
+#include <pthread.h>
+#pragma pack(pop)
+
+// The value a game's result is trained towards, for black: 1 for a black
+// win, 0 for a white win or a draw. Shared by TD (online) and
+// PositionStream (offline), so both learn the same function.
+static inline double result_target(Color winner) {
+        return winner == BLACK ? 1.0 : 0.0;
+}
+
+//-----------------------------------------------------------------------------
+//
+// PositionStream
+//
+// Feeds minibatches of positions from recorded games (see record.h) to
+// offline training, e.g. FFNet::train_loop or RBM::train_minibatch. A
+// producer thread replays the games through S::move, reads the first SIZE
+// features of every position reached through S::operator[] and passes them
+// through a shuffle buffer of `shuffle` positions; full minibatches queue up
+// in DEPTH slots, so decoding runs while the caller trains on the previous
+// batch.
+//
+// Each epoch visits the games in a new random order. A position leaves the
+// shuffle buffer when a newer one takes its (random) slot, so positions of
+// one game are spread over about `shuffle` positions of the stream; the
+// buffer is drained in random order after the last epoch, and the last
+// minibatch may be short.
+//
+// The target is the game's result_target(), as in TD: 1 for a black win, 0
+// for a white win or a draw. With bias set, input gets a last
+// column of ones, as FFNet's train_loop expects; RBMs take input as is.
+//
+//      PositionStream<S, SIZE> stream(reader, 256);
+//      stream.start(epochs);
+//      while (const PositionStream<S, SIZE>::Minibatch *b = stream.next()) {
+//              net.train_loop(b->input, b->target, 0, learning_rate, 1);
+//              stream.release();
+//      }
+//
+//-----------------------------------------------------------------------------
+
+template <typename S, size_t SIZE, typename Mat=arma::mat>
+struct PositionStream {
+        typedef typename S::M M;
+        enum { DEPTH = 4 };
+
+        struct Minibatch {
+                Mat input, target;
+                size_t size;
+        };
+
+        const RecordReader<M> &reader;
+        size_t batch_size, shuffle;
+        bool bias;
+
+        // shuffle buffer, one row of SIZE features per position
+        vector<float> features, results;
+        size_t buffered;
+        unsigned seed;
+
+        // minibatches from the producer: slots [head, tail) are full
+        Minibatch slots[DEPTH];
+        size_t head, tail, epochs, positions;
+        bool finished, stop, running;
+        pthread_t thread;
+        pthread_mutex_t mutex;
+        pthread_cond_t filled, emptied;
+
+        PositionStream(const RecordReader<M> &r, size_t batch, size_t shuffle_size=1<<16, bool with_bias=true)
+                : reader(r), batch_size(batch), shuffle(std::max<size_t>(shuffle_size, 1)),
+                  bias(with_bias), buffered(0), seed(random()),
+                  head(0), tail(0), epochs(0), positions(0),
+                  finished(false), stop(false), running(false)
+        {
+                assert(batch_size > 0);
+                pthread_mutex_init(&mutex, NULL);
+                pthread_cond_init(&filled, NULL);
+                pthread_cond_init(&emptied, NULL);
+                for (size_t i=0; i < DEPTH; ++i) {
+                        slots[i].input.set_size(batch_size, SIZE + bias);
+                        slots[i].target.set_size(batch_size, 1);
+                        slots[i].size = 0;
+                }
+        }
+
+        ~PositionStream() {
+                join();
+                pthread_mutex_destroy(&mutex);
+                pthread_cond_destroy(&filled);
+                pthread_cond_destroy(&emptied);
+        }
+
+        void start(size_t num_epochs=1) {
+                join();
+                epochs = num_epochs;
+                head = tail = 0;
+                positions = buffered = 0;
+                finished = stop = false;
+                features.resize(shuffle * SIZE);
+                results.resize(shuffle);
+                running = true;
+                pthread_create(&thread, NULL, spawn_thread, this);
+        }
+
+        // the next minibatch, or NULL after the last; valid until release()
+        const Minibatch *next() {
+                pthread_mutex_lock(&mutex);
+                while (head == tail && !finished)
+                        pthread_cond_wait(&filled, &mutex);
+                Minibatch *b = (head == tail) ? NULL : &slots[head % DEPTH];
+                pthread_mutex_unlock(&mutex);
+                return b;
+        }
+
+        void release() {
+                pthread_mutex_lock(&mutex);
+                assert(head != tail);
+                head++;
+                pthread_cond_signal(&emptied);
+                pthread_mutex_unlock(&mutex);
+        }
+
+        // stops the producer early, dropping queued minibatches
+        void join() {
+                if (!running)
+                        return;
+                pthread_mutex_lock(&mutex);
+                stop = true;
+                pthread_cond_signal(&emptied);
+                pthread_mutex_unlock(&mutex);
+                pthread_join(thread, NULL);
+                running = false;
+        }
+
+private:
+        static void *spawn_thread(void *self) {
+                ((PositionStream *) self)->produce();
+                return NULL;
+        }
+
+        float outcome(Color winner) const { return result_target(winner); }
+
+        void produce() {
+                vector<size_t> order(reader.size());
+                for (size_t i=0; i < order.size(); ++i)
+                        order[i] = i;
+
+                Minibatch *b = acquire();
+                for (size_t e=0; b && e < epochs; ++e) {
+                        for (size_t i=order.size(); i > 1; --i)
+                                std::swap(order[i-1], order[rand_r(&seed) % i]);
+                        for (size_t g=0; b && g < order.size(); ++g) {
+                                GameRecord<M> record = reader[order[g]];
+                                float result = outcome(record.winner());
+                                for (Replay<S> r(record); b && !r.done(); ) {
+                                        r.advance();
+                                        b = add(b, r.state, result);
+                                }
+                        }
+                }
+
+                // drain the shuffle buffer
+                while (b && buffered > 0) {
+                        size_t i = rand_r(&seed) % buffered;
+                        b = emit(b, i);
+                        buffered--;
+                        move_row(buffered, i);
+                }
+                if (b && b->size > 0) {
+                        b->input.resize(b->size, SIZE + bias);
+                        b->target.resize(b->size, 1);
+                        publish();
+                }
+
+                pthread_mutex_lock(&mutex);
+                finished = true;
+                pthread_cond_signal(&filled);
+                pthread_mutex_unlock(&mutex);
+        }
+
+        // waits for a free slot; NULL once stopped
+        Minibatch *acquire() {
+                pthread_mutex_lock(&mutex);
+                while (tail - head == DEPTH && !stop)
+                        pthread_cond_wait(&emptied, &mutex);
+                Minibatch *b = stop ? NULL : &slots[tail % DEPTH];
+                pthread_mutex_unlock(&mutex);
+                if (b) {
+                        b->size = 0;
+                        if (b->input.n_rows != batch_size) { // after a short batch
+                                b->input.set_size(batch_size, SIZE + bias);
+                                b->target.set_size(batch_size, 1);
+                        }
+                }
+                return b;
+        }
+
+        void publish() {
+                pthread_mutex_lock(&mutex);
+                tail++;
+                pthread_cond_signal(&filled);
+                pthread_mutex_unlock(&mutex);
+        }
+
+        Minibatch *add(Minibatch *b, S &state, float result) {
+                size_t slot;
+                if (buffered < shuffle) {
+                        slot = buffered++;
+                } else {
+                        slot = rand_r(&seed) % shuffle;
+                        b = emit(b, slot);
+                        if (!b)
+                                return NULL;
+                }
+                float *row = &features[slot * SIZE];
+                for (size_t j=0; j < SIZE; ++j)
+                        row[j] = state[j];
+                results[slot] = result;
+                positions++;
+                return b;
+        }
+
+        // copies buffered position i into b, publishing b when it is full
+        Minibatch *emit(Minibatch *b, size_t i) {
+                size_t n = b->size++;
+                const float *row = &features[i * SIZE];
+                for (size_t j=0; j < SIZE; ++j)
+                        b->input(n, j) = row[j];
+                if (bias)
+                        b->input(n, SIZE) = 1;
+                b->target(n, 0) = results[i];
+
+                if (b->size < batch_size)
+                        return b;
+                publish();
+                return acquire();
+        }
+
+        void move_row(size_t from, size_t to) {
+                if (from == to)
+                        return;
+                memcpy(&features[to * SIZE], &features[from * SIZE], SIZE * sizeof(float));
+                results[to] = results[from];
+        }
+
+        PositionStream(const PositionStream &);
+        PositionStream& operator=(const PositionStream &);
+};
+
+#endif // PIPELINE_H
@@ -0,0 +1,86 @@
+#ifndef PONDER_H
+#define PONDER_H
+#pragma once
+
+#include "common.h"
+
+// default packing, in case a header included before this one left
+// #pragma pack(1) set
+#pragma pack(push)
+#pragma pack()
+#include <pthread.h>
+
+//-----------------------------------------------------------------------------
+//
+// Ponder
+//
+// Searching on the opponent's time. An engine that ponders starts a search
+// of the position after its own move before next() returns, and stops it at
+// the start of its next next(); whatever that search found under the reply
+// the opponent actually played is reused (see UCT and BasicMinimax). Against
+// Human<S>, the engine searches for as long as the human thinks.
+//
+// Ponder runs owner->ponder_search() on a thread of its own. The search
+// polls stopped() and returns soon after stop() is called; stop() waits for
+// it, so after stop() the engine owns its search state again. An engine
+// calls stop() in its destructor, before its members go away.
+//
+// same_position() tells whether the position searched under a reply is the
+// position the engine is given. It compares bytes, which is exact for the
+// games' states (copied with memcpy); a state that differs only in bytes the
+// game ignores is merely not reused.
+//
+//-----------------------------------------------------------------------------
+
+struct Ponder {
+        pthread_t thread;
+        bool running;
+        volatile int stop_flag, done;
+        void (*search)(void *);
+        void *owner;
+
+        Ponder() : running(false), stop_flag(0), done(0), search(0), owner(0) {}
+        ~Ponder() { stop(); }
+
+        template <typename T>
+        static void call_search(void *owner) { ((T *) owner)->ponder_search(); }
+
+        static void *spawn_thread(void *self) {
+                Ponder *p = (Ponder *) self;
+                p->search(p->owner);
+                p->done = 1;
+                return NULL;
+        }
+
+        template <typename T>
+        void start(T *o) {
+                stop();
+                stop_flag = done = 0;
+                search = call_search<T>;
+                owner = o;
+                running = true;
+                pthread_create(&thread, NULL, spawn_thread, this);
+        }
+
+        void stop() {
+                if (!running)
+                        return;
+                stop_flag = 1;
+                pthread_join(thread, NULL);
+                running = false;
+        }
+
+        bool stopped() const { return stop_flag; }
+
+        // the search ran out of work before it was stopped
+        bool finished() const { return done; }
+};
+
+template <typename S>
+bool same_position(const S &a, const S &b) {
+        return memcmp(&a, &b, sizeof(S)) == 0;
+}
+
+#pragma pack(pop)
+
+#endif // PONDER_H
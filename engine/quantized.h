@@ -0,0 +1,157 @@
+#ifndef GGP_QUANTIZED_H
+#define GGP_QUANTIZED_H
+#pragma once
+
+#include "common.h"
+#include "neural.h"
+#include "simd.h"
+
+//-----------------------------------------------------------------------------------
+//
+// QuantizedFFNet
+//
+// Post-training int8 copy of an FFNet for move-time evaluation. Weights of
+// each layer are scaled symmetrically to [-127,127]; inputs (expected in
+// [-1,1], as board values are) and hidden activations are int16 of the same
+// range, so both layers are int16 x int8 dot products with int32 sums. The
+// hidden activation is a lookup table over a clipped range of
+// pre-activations; only the output activation is computed in float.
+//
+// quantize() must be called again after the float net is trained.
+//
+//-----------------------------------------------------------------------------------
+
+template <size_t NUM_INPUT,
+	  size_t NUM_HIDDEN,
+	  size_t NUM_OUTPUT,
+          typename FH=Sigmoid,
+          typename FO=Sigmoid>
+struct QuantizedFFNet {
+        typedef FFNet<NUM_INPUT,NUM_HIDDEN,NUM_OUTPUT,FH,FO> NN;
+
+        enum { INPUT_STRIDE  = SIMD_PAD16(NUM_INPUT),
+               HIDDEN_STRIDE = SIMD_PAD16(NUM_HIDDEN),
+               LUT_SIZE      = 4096 };
+
+        static const float INPUT_SCALE;
+        static const float LUT_RANGE; // pre-activations are clipped to +/- this
+
+        AlignedBuffer<int8_t> w1, // HIDDEN_STRIDE rows of INPUT_STRIDE, zero padded
+                              w2; // NUM_OUTPUT rows of HIDDEN_STRIDE
+        int32_t b1[HIDDEN_STRIDE], b2[NUM_OUTPUT];
+        int16_t lut[LUT_SIZE];
+        float scale2,     // int32 output sum -> float pre-activation
+              lut_scale,  // int32 hidden sum -> lut index
+              lut_offset;
+
+        QuantizedFFNet()
+                : w1(HIDDEN_STRIDE * INPUT_STRIDE),
+                  w2(NUM_OUTPUT * HIDDEN_STRIDE),
+                  scale2(0), lut_scale(0), lut_offset(0)
+        {}
+
+        QuantizedFFNet(const NN &net)
+                : w1(HIDDEN_STRIDE * INPUT_STRIDE),
+                  w2(NUM_OUTPUT * HIDDEN_STRIDE)
+        {
+                quantize(net);
+        }
+
+        static float max_abs(const arma::mat &m) {
+                double r = 0;
+                for (size_t i=0; i < m.n_elem; ++i)
+                        r = std::max(r, fabs(m(i)));
+                return r > 0 ? r : 1;
+        }
+
+        static int8_t clip8(float x) {
+                long v = lrintf(x);
+                return v > 127 ? 127 : (v < -127 ? -127 : v);
+        }
+
+        void quantize(const NN &net) {
+                float ws1 = 127 / max_abs(net.w1),
+                      ws2 = 127 / max_abs(net.w2);
+
+                // hidden activations and their output scale
+                float lut_float[LUT_SIZE], out_max = 0,
+                      lut_step = (2*LUT_RANGE) / (LUT_SIZE-1);
+                for (size_t i=0; i < LUT_SIZE; ++i) {
+                        lut_float[i] = FH::activation(-LUT_RANGE + i*lut_step);
+                        out_max = std::max(out_max, fabsf(lut_float[i]));
+                }
+                if (out_max == 0)
+                        out_max = 1;
+                float hs = 127 / out_max;
+                for (size_t i=0; i < LUT_SIZE; ++i)
+                        lut[i] = lrintf(lut_float[i] * hs);
+
+                w1.clear();
+                memset(b1, 0, sizeof(b1));
+                for (size_t j=0; j < NUM_HIDDEN; ++j) {
+                        for (size_t i=0; i < NUM_INPUT; ++i)
+                                w1[j*INPUT_STRIDE + i] = clip8(net.w1(i, j) * ws1);
+                        b1[j] = lrintf(net.w1(NUM_INPUT, j) * ws1 * INPUT_SCALE);
+                }
+                w2.clear();
+                for (size_t k=0; k < NUM_OUTPUT; ++k) {
+                        for (size_t j=0; j < NUM_HIDDEN; ++j)
+                                w2[k*HIDDEN_STRIDE + j] = clip8(net.w2(j, k) * ws2);
+                        b2[k] = lrintf(net.w2(NUM_HIDDEN, k) * ws2 * hs);
+                }
+
+                scale2 = 1 / (ws2 * hs);
+                lut_scale = 1 / (ws1 * INPUT_SCALE * lut_step);
+                lut_offset = (LUT_SIZE-1) / 2.0;
+        }
+
+        int16_t activation(int32_t sum) const {
+                float i = sum * lut_scale + lut_offset;
+                if (i <= 0) return lut[0];
+                if (i >= LUT_SIZE-1) return lut[LUT_SIZE-1];
+                return lut[size_t(i + 0.5f)];
+        }
+
+        // input holds INPUT_STRIDE int16 values aligned to SIMD_ALIGN, see
+        // set_input()
+        void fprop(const int16_t *input, float *output) const {
+                int16_t hidden[HIDDEN_STRIDE] __attribute__((aligned(SIMD_ALIGN)));
+                int32_t sum[4];
+                // padding units get activation(0), but their w2 entries are 0
+                for (size_t j=0; j < HIDDEN_STRIDE; j += 4) {
+                        simd::dot4(input, &w1[j*INPUT_STRIDE], INPUT_STRIDE, INPUT_STRIDE, sum);
+                        for (size_t r=0; r < 4; ++r)
+                                hidden[j+r] = activation(b1[j+r] + sum[r]);
+                }
+                for (size_t k=0; k < NUM_OUTPUT; ++k)
+                        output[k] = FO::activation(scale2 * (b2[k] +
+                                simd::dot(hidden, &w2[k*HIDDEN_STRIDE], HIDDEN_STRIDE)));
+        }
+
+        static int16_t quantize_input(float x) {
+                if (x >= 1) return INPUT_SCALE;
+                if (x <= -1) return -INPUT_SCALE;
+                return int16_t(x * INPUT_SCALE + (x < 0 ? -0.5f : 0.5f));
+        }
+
+        static void set_input(int16_t *q, const float *input) {
+                for (size_t i=0; i < NUM_INPUT; ++i)
+                        q[i] = quantize_input(input[i]);
+                for (size_t i=NUM_INPUT; i < INPUT_STRIDE; ++i)
+                        q[i] = 0;
+        }
+
+        void fprop(const float *input, float *output) const {
+                int16_t q[INPUT_STRIDE] __attribute__((aligned(SIMD_ALIGN)));
+                set_input(q, input);
+                fprop(q, output);
+        }
+};
+
+template <size_t I, size_t H, size_t O, typename FH, typename FO>
+const float QuantizedFFNet<I,H,O,FH,FO>::INPUT_SCALE = 127;
+
+template <size_t I, size_t H, size_t O, typename FH, typename FO>
+const float QuantizedFFNet<I,H,O,FH,FO>::LUT_RANGE = 8;
+
+#endif // GGP_QUANTIZED_H
@@ -4,21 +4,31 @@
 // NOTE: ported from the python code by Edwin Chen
 
 #include "common.h"
+#include "thread.h"
 
 #include <armadillo>
 
+#include <algorithm>
+#include <vector>
+
+
+// Mat is arma::mat or arma::fmat; RBM (double) is the original interface,
+// FloatRBM halves the memory and bandwidth of large board datasets.
+template <typename Mat>
+struct BasicRBM {
+        typedef typename Mat::elem_type T;
 
-struct RBM {
         size_t num_hidden, num_visible;
         float learning_rate;
-        arma::mat weights;
+        Mat weights;
+        std::vector<Mat> chains; // of persistent CD, one per shard
 
-        RBM(size_t vis, size_t hid, float alpha)
+        BasicRBM(size_t vis, size_t hid, float alpha)
                 : num_hidden(hid),
                   num_visible(vis),
                   learning_rate(alpha)
         {
-                weights = arma::randu(num_visible, num_hidden) * 0.1;
+                weights = arma::randu<Mat>(num_visible, num_hidden) * 0.1;
 
                 // insert weights for bias
                 weights = prefix_zeros(weights);
@@ -28,26 +38,26 @@ struct RBM {
                 weights.save(s);
         }
 
-        arma::mat prefix_zeros(arma::mat m) {
-                return arma::join_rows(arma::zeros(m.n_rows+1,1),
-                                arma::join_cols(arma::zeros(1,m.n_cols), m));
+        Mat prefix_zeros(const Mat &m) {
+                return arma::join_rows(arma::zeros<Mat>(m.n_rows+1,1),
+                                arma::join_cols(arma::zeros<Mat>(1,m.n_cols), m));
         }
 
-        arma::mat prefix_bias(arma::mat m) {
-                return arma::join_rows(arma::ones(m.n_rows,1), m);
+        Mat prefix_bias(const Mat &m) {
+                return arma::join_rows(arma::ones<Mat>(m.n_rows,1), m);
         }
 
-        arma::mat logistic(arma::mat x) {
+        Mat logistic(const Mat &x) {
                 return 1/(1+arma::exp(-x));
         }
 
-        arma::mat prob_on(arma::mat probs) {
-                return arma::conv_to<arma::mat>::from(
-                                probs > arma::randu(probs.n_rows, probs.n_cols));
+        Mat prob_on(const Mat &probs) {
+                return arma::conv_to<Mat>::from(
+                                probs > arma::randu<Mat>(probs.n_rows, probs.n_cols));
         }
 
-        float train(arma::mat _data, size_t max_epochs=1000, bool verbose=false) {
-                arma::mat data,
+        float train(const Mat &_data, size_t max_epochs=1000, bool verbose=false) {
+                Mat data,
                           pos_hidden_activations,
                           pos_hidden_probs,
                           pos_hidden_states,
@@ -81,7 +91,7 @@ struct RBM {
                         neg_visible_activations = pos_hidden_states * weights.t();
                         neg_visible_probs = logistic(neg_visible_activations);
                         // fix bias unit
-                        neg_visible_probs.col(0) = arma::ones(neg_visible_probs.n_rows, 1);
+                        neg_visible_probs.col(0) = arma::ones<Mat>(neg_visible_probs.n_rows, 1);
                         neg_hidden_activations = neg_visible_probs * weights;
                         neg_hidden_probs = logistic(neg_hidden_activations);
                         neg_associations = neg_visible_probs.t() * neg_hidden_probs;
@@ -90,11 +100,11 @@ struct RBM {
                                 / float(num_examples));
 
                         if (verbose) {
-                                error = sum(sum(square(data-neg_visible_probs)));
+                                error = arma::accu(arma::square(data-neg_visible_probs));
                                 LOG("epoch " << epoch << ": error is " << error);
                         }
                 }
-                return sum(sum(square(data-neg_visible_probs)));
+                return arma::accu(arma::square(data-neg_visible_probs));
         }
 
         // Assuming the RBM has been trained (so that weights for the network have
@@ -110,8 +120,8 @@ struct RBM {
         // hidden_states: A matrix where each row consists of the hidden units activated
         // from the visible units in the data matrix passed in.
 
-        arma::mat run_visible(arma::mat _data) {
-                arma::mat data,
+        Mat run_visible(const Mat &_data) {
+                Mat data,
                           hidden_states,
                           hidden_activations,
                           hidden_probs;
@@ -119,7 +129,7 @@ struct RBM {
                 size_t num_examples = _data.n_rows;
                 // Create a matrix, where each row is to be the hidden units (plus a bias unit)
                 // sampled from a training example.
-                hidden_states = arma::ones(num_examples, num_hidden+1);
+                hidden_states = arma::ones<Mat>(num_examples, num_hidden+1);
     
                 // Insert bias units of 1 into the first column of data.
                 data = prefix_bias(_data);
@@ -138,8 +148,8 @@ struct RBM {
         }
     
         // same as run_visible, but return the raw probabilities as softmax
-        arma::mat run_visible_p(arma::mat _data) {
-                arma::mat data,
+        Mat run_visible_p(const Mat &_data) {
+                Mat data,
                           hidden_states,
                           hidden_activations,
                           hidden_probs;
@@ -147,7 +157,7 @@ struct RBM {
                 size_t num_examples = _data.n_rows;
                 // Create a matrix, where each row is to be the hidden units (plus a bias unit)
                 // sampled from a training example.
-                hidden_states = arma::ones(num_examples, num_hidden+1);
+                hidden_states = arma::ones<Mat>(num_examples, num_hidden+1);
     
                 // Insert bias units of 1 into the first column of data.
                 data = prefix_bias(_data);
@@ -161,7 +171,7 @@ struct RBM {
                 return hidden_probs.cols(1,hidden_probs.n_cols-1);
         }
     
-        arma::mat run_hidden(arma::mat _data) {
+        Mat run_hidden(const Mat &_data) {
                 // Assuming the RBM has been trained (so that weights for the
                 // network have been learned), run the network on a set of hidden
                 // units, to get a sample of the visible units.
@@ -176,7 +186,7 @@ struct RBM {
                 // visible_states: A matrix where each row consists of the visible
                 // units activated from the hidden  units in the data matrix passed in.
 
-                arma::mat data,
+                Mat data,
                           visible_states,
                           visible_activations,
                           visible_probs;
@@ -186,7 +196,7 @@ struct RBM {
 
                 // Create a matrix, where each row is to be the visible units
                 // (plus a bias unit) sampled from a training example.
-                visible_states = arma::ones(num_examples, num_visible+1);
+                visible_states = arma::ones<Mat>(num_examples, num_visible+1);
 
                 // Insert bias units of 1 into the first column of data.
                 data = prefix_bias(_data);
@@ -204,9 +214,9 @@ struct RBM {
                 return visible_states.cols(1,visible_states.n_cols-1);
         }
     
-        arma::mat run_hidden_p(arma::mat _data) {
+        Mat run_hidden_p(const Mat &_data) {
                 // same as run_hidden, but return raw probabilities
-                arma::mat data,
+                Mat data,
                           visible_states,
                           visible_activations,
                           visible_probs;
@@ -216,7 +226,7 @@ struct RBM {
 
                 // Create a matrix, where each row is to be the visible units
                 // (plus a bias unit) sampled from a training example.
-                visible_states = arma::ones(num_examples, num_visible+1);
+                visible_states = arma::ones<Mat>(num_examples, num_visible+1);
 
                 // Insert bias units of 1 into the first column of data.
                 data = prefix_bias(_data);
@@ -230,7 +240,7 @@ struct RBM {
                 return visible_probs.cols(1, visible_probs.n_cols-1);
         }
 
-        arma::mat daydream(size_t num_samples) {
+        Mat daydream(size_t num_samples) {
                 // Randomly initialize the visible units once, and start running
                 // alternating Gibbs sampling steps (where each step consists of
                 // updating all the hidden units, and then updating all of the
@@ -244,7 +254,7 @@ struct RBM {
                 // produced while the network was daydreaming.
 
 
-                arma::mat samples,
+                Mat samples,
                           visible,
                           hidden_activations,
                           hidden_probs,
@@ -255,10 +265,10 @@ struct RBM {
 
                 // Create a matrix, where each row is to be a sample of of the
                 // visible units (with an extra bias unit), initialized to all ones.
-                samples = arma::ones(num_samples, num_visible+1);
+                samples = arma::ones<Mat>(num_samples, num_visible+1);
 
                 // Take the first sample from a uniform distribution.
-                samples.row(0).cols(1,num_visible) = arma::randu(num_visible).t();
+                samples.row(0).cols(1,num_visible) = arma::randu<Mat>(1, num_visible);
 
                 // Start the alternating Gibbs sampling.
                 // Note that we keep the hidden units binary states, but leave the
@@ -289,6 +299,210 @@ struct RBM {
                 // set to 1.
                 return samples.cols(1,samples.n_cols-1);
         }
+
+
+        //-------------------------------------------------------------------
+        //
+        // Minibatch training
+        //
+        // train_minibatch() runs CD-1, or persistent CD (the negative phase
+        // continues a Markov chain per batch row instead of restarting at
+        // the data), over shuffled minibatches of the rows of data. Each
+        // minibatch is split into one shard per thread; a shard gathers its
+        // rows straight from data and computes its share of the gradient in
+        // buffers allocated once per call, and the shares are summed before
+        // the weight update. The threads are started once per call. Rows
+        // left over after the last full minibatch of an epoch are skipped;
+        // the shuffle changes which.
+        //
+        // The persistent chains carry over from one call to the next as long
+        // as the batch size and the number of threads stay the same;
+        // otherwise they restart at the data.
+        //
+        //-------------------------------------------------------------------
+
+        struct Shard {
+                const BasicRBM *rbm;
+                const Mat *data;
+                const size_t *rows;  // indices into data
+                size_t count;
+                bool persistent, chain_ready;
+                uint32_t seed;
+                float error;
+                Mat batch,              // count x (num_visible+1), bias first
+                    pos_hidden_probs,   // count x (num_hidden+1)
+                    hidden_states,
+                    neg_visible_probs,  // count x (num_visible+1)
+                    neg_hidden_probs,
+                    chain,              // persistent visible states
+                    gradient;           // (num_visible+1) x (num_hidden+1)
+
+                Shard() : rbm(0), data(0), rows(0), count(0),
+                          persistent(false), chain_ready(false),
+                          seed(random()), error(0) {}
+
+                void resize(size_t n) {
+                        count = n;
+                        batch.set_size(n, rbm->num_visible+1);
+                        batch.col(0).ones();
+                        gradient.set_size(rbm->num_visible+1, rbm->num_hidden+1);
+                }
+
+                // thread local, so shards do not contend for random()
+                T uniform() {
+                        seed = seed * 1664525u + 1013904223u;
+                        return T(seed >> 8) * T(1.0 / 16777216.0);
+                }
+
+                static void logistic(Mat &m) {
+                        T *p = m.memptr();
+                        for (size_t i=0; i < m.n_elem; ++i)
+                                p[i] = 1 / (1 + std::exp(-p[i]));
+                }
+
+                void sample(const Mat &probs, Mat &states) {
+                        states.set_size(probs.n_rows, probs.n_cols);
+                        const T *p = probs.memptr();
+                        T *s = states.memptr();
+                        for (size_t i=0; i < probs.n_elem; ++i)
+                                s[i] = p[i] > uniform();
+                }
+
+                void gather() {
+                        for (size_t v=0; v < rbm->num_visible; ++v) {
+                                const T *src = data->colptr(v);
+                                T *dst = batch.colptr(v+1);
+                                for (size_t r=0; r < count; ++r)
+                                        dst[r] = src[rows[r]];
+                        }
+                }
+
+                void operator() () {
+                        const Mat &w = rbm->weights;
+                        gather();
+
+                        // positive phase
+                        pos_hidden_probs = batch * w;
+                        logistic(pos_hidden_probs);
+
+                        // negative phase, from the data or the chain
+                        if (persistent) {
+                                if (!chain_ready) {
+                                        chain = batch;
+                                        chain_ready = true;
+                                }
+                                neg_hidden_probs = chain * w;
+                                logistic(neg_hidden_probs);
+                                sample(neg_hidden_probs, hidden_states);
+                        } else {
+                                sample(pos_hidden_probs, hidden_states);
+                        }
+                        neg_visible_probs = hidden_states * w.t();
+                        logistic(neg_visible_probs);
+                        neg_visible_probs.col(0).ones();
+                        neg_hidden_probs = neg_visible_probs * w;
+                        logistic(neg_hidden_probs);
+
+                        gradient = batch.t() * pos_hidden_probs;
+                        gradient -= neg_visible_probs.t() * neg_hidden_probs;
+
+                        // the chain is no reconstruction of the batch, so
+                        // persistent CD needs one more pass for the error
+                        if (persistent) {
+                                chain = neg_visible_probs;
+                                sample(pos_hidden_probs, hidden_states);
+                                neg_visible_probs = hidden_states * w.t();
+                                logistic(neg_visible_probs);
+                                neg_visible_probs.col(0).ones();
+                        }
+
+                        error = 0;
+                        const T *a = batch.memptr(), *b = neg_visible_probs.memptr();
+                        for (size_t i=0; i < batch.n_elem; ++i)
+                                error += (a[i]-b[i]) * (a[i]-b[i]);
+                }
+        };
+
+        struct ShardJob : ThreadPool::Job {
+                std::vector<Shard> &shards;
+                ShardJob(std::vector<Shard> &s) : shards(s) {}
+                void operator() (size_t i) { shards[i](); }
+        };
+
+        // returns the mean squared reconstruction error per row of the last
+        // epoch
+        float train_minibatch(const Mat &data, size_t batch_size, size_t max_epochs=1,
+                              bool persistent=false, size_t num_threads=NUM_THREADS,
+                              bool verbose=false) {
+                assert(data.n_cols == num_visible);
+                size_t n = data.n_rows;
+                if (batch_size > n)
+                        batch_size = n;
+                if (num_threads > batch_size)
+                        num_threads = batch_size;
+                if (num_threads < 1)
+                        num_threads = 1;
+
+                std::vector<size_t> order(n);
+                for (size_t i=0; i < n; ++i)
+                        order[i] = i;
+
+                std::vector<Shard> shards(num_threads);
+                for (size_t t=0; t < num_threads; ++t) {
+                        size_t count = batch_size / num_threads
+                                     + (t < batch_size % num_threads ? 1 : 0);
+                        shards[t].rbm = this;
+                        shards[t].data = &data;
+                        shards[t].persistent = persistent;
+                        shards[t].resize(count);
+                        if (persistent && chains.size() == num_threads
+                                       && chains[t].n_rows == count) {
+                                shards[t].chain = chains[t];
+                                shards[t].chain_ready = true;
+                        }
+                }
+
+                ThreadPool pool(num_threads-1);
+                ShardJob job(shards);
+
+                size_t batches = n / batch_size;
+                float error = 0;
+                for (size_t epoch=0; epoch < max_epochs; ++epoch) {
+                        for (size_t i=n-1; i > 0; --i)
+                                std::swap(order[i], order[random() % (i+1)]);
+                        error = 0;
+
+                        for (size_t b=0; b < batches; ++b) {
+                                const size_t *rows = &order[b*batch_size];
+                                for (size_t t=0, first=0; t < num_threads; ++t) {
+                                        shards[t].rows = rows + first;
+                                        first += shards[t].count;
+                                }
+
+                                pool.run(job, num_threads);
+                                for (size_t t=0; t < num_threads; ++t) {
+                                        error += shards[t].error;
+                                        if (t > 0)
+                                                shards[0].gradient += shards[t].gradient;
+                                }
+                                weights += (learning_rate / T(batch_size)) * shards[0].gradient;
+                        }
+
+                        error /= float(batches * batch_size);
+                        if (verbose)
+                                LOG("epoch " << epoch << ": error is " << error);
+                }
+
+                if (persistent) {
+                        chains.resize(num_threads);
+                        for (size_t t=0; t < num_threads; ++t)
+                                chains[t] = shards[t].chain;
+                }
+                return error;
+        }
 };
 
+typedef BasicRBM<arma::mat> RBM;
+typedef BasicRBM<arma::fmat> FloatRBM;
+
 #endif // GGP_RBM_H
@@ -0,0 +1,373 @@
+#ifndef RECORD_H
+#define RECORD_H
+#pragma once
+
+#include "common.h"
+
+// default packing for the system structs (struct stat), in case a header
+// included before this one left #pragma pack(1) set
+#pragma pack(push)
+#pragma pack()
+#include <vector>
+#include <utility>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#pragma pack(pop)
+
+//-----------------------------------------------------------------------------
+//
+// Game records
+//
+// An append-only binary file of played games, for offline training. The
+// file starts with a RecordFileHeader; each game is a RecordGameHeader, the
+// moves as the game's packed Move structs, then (if RECORD_VISITS is set)
+// for every move a uint16_t count and that many RecordVisit, the root visit
+// counts of the search that chose it. All in host byte order.
+//
+// A game is written with a single fwrite once it is over and flushed, so a
+// crash loses at most the game in progress. The reader stops at the first
+// game that does not fit, and a writer opening the file cuts such a partial
+// game off before appending, so later games stay aligned.
+//
+//-----------------------------------------------------------------------------
+
+static const char RECORD_MAGIC[4] = { 'G', 'G', 'P', 'R' };
+static const uint16_t RECORD_VERSION = 1;
+
+enum { RECORD_VISITS = 1 };
+
+#pragma pack(push, 1)
+struct RecordFileHeader {
+        char magic[4];
+        uint16_t version;
+        uint16_t move_size;     // sizeof(M), checked by the reader
+};
+
+struct RecordGameHeader {
+        uint32_t size;          // of the whole game, header included
+        uint64_t id;
+        float params[2];        // of black and white (see Game::set_param)
+        uint16_t num_moves;
+        int8_t winner;          // Color
+        uint8_t flags;
+};
+
+template <typename M>
+struct RecordVisit {
+        M move;
+        uint32_t visits;
+};
+#pragma pack(pop)
+
+static inline void check_record_header(const RecordFileHeader &h, const char *path, size_t move_size) {
+        if (memcmp(h.magic, RECORD_MAGIC, sizeof(h.magic)) || h.version != RECORD_VERSION)
+                DIE("not a game record file: " << path);
+        if (h.move_size != move_size)
+                DIE("moves of " << path << " are " << h.move_size << " bytes, expected " << move_size);
+}
+
+//-----------------------------------------------------------------------------
+//
+// RecordWriter
+//
+// Collects one game at a time: begin(), add() for every move, end() with the
+// winner. add() takes the root visit distribution of the move's search, as
+// kept by UCT when record_visits is set; either every move of a game has one
+// or none does.
+//
+// An existing file is appended to once its header has been checked and a
+// partial last game, left by a crash during its write, has been cut off.
+//
+//-----------------------------------------------------------------------------
+
+template <typename M>
+struct RecordWriter {
+        typedef RecordVisit<M> Visit;
+        typedef std::vector<std::pair<M, uint32_t> > Visits;
+
+        FILE *file;
+        RecordGameHeader header;
+        std::vector<M> moves;
+        std::vector<Visits> visits;
+        std::vector<char> buffer;
+        size_t games;
+
+        RecordWriter(const char *path) : file(NULL), games(0) {
+                file = fopen(path, "r+b");
+                if (!file && errno == ENOENT)
+                        file = fopen(path, "w+b");
+                if (!file)
+                        DIE("cannot open " << path << ": " << strerror(errno));
+                fseek(file, 0, SEEK_END);
+                size_t length = ftell(file);
+                if (length == 0) {
+                        RecordFileHeader h;
+                        memcpy(h.magic, RECORD_MAGIC, sizeof(h.magic));
+                        h.version = RECORD_VERSION;
+                        h.move_size = sizeof(M);
+                        fwrite(&h, sizeof(h), 1, file);
+                } else {
+                        size_t end = complete_length(path, length);
+                        if (end < length && ftruncate(fileno(file), end) < 0)
+                                DIE("cannot truncate " << path << ": " << strerror(errno));
+                        fseek(file, end, SEEK_SET);
+                }
+                memset(&header, 0, sizeof(header));
+        }
+
+        ~RecordWriter() {
+                if (file)
+                        fclose(file);
+        }
+
+        void begin(uint64_t id, float black_param=0, float white_param=0) {
+                memset(&header, 0, sizeof(header));
+                header.id = id;
+                header.params[0] = black_param;
+                header.params[1] = white_param;
+                moves.clear();
+                visits.clear();
+        }
+
+        void add(const M &m) {
+                assert(visits.empty());
+                moves.push_back(m);
+        }
+
+        void add(const M &m, const Visits &v) {
+                assert(visits.size() == moves.size());
+                moves.push_back(m);
+                visits.push_back(v);
+        }
+
+        void end(Color winner) {
+                assert(moves.size() <= 0xffff);
+                header.num_moves = moves.size();
+                header.winner = winner;
+                header.flags = visits.empty() ? 0 : RECORD_VISITS;
+
+                buffer.resize(sizeof(header));
+                if (!moves.empty())
+                        append(&moves[0], moves.size() * sizeof(M));
+                for (size_t i=0; i < visits.size(); ++i) {
+                        uint16_t n = visits[i].size();
+                        append(&n, sizeof(n));
+                        for (size_t j=0; j < n; ++j) {
+                                Visit v;
+                                v.move = visits[i][j].first;
+                                v.visits = visits[i][j].second;
+                                append(&v, sizeof(v));
+                        }
+                }
+                header.size = buffer.size();
+                memcpy(&buffer[0], &header, sizeof(header));
+
+                if (fwrite(&buffer[0], buffer.size(), 1, file) != 1)
+                        DIE("cannot write game record: " << strerror(errno));
+                fflush(file);
+                games++;
+        }
+
+        void sync() { fflush(file); }
+
+private:
+        // checks the header of an existing file and returns the length of
+        // its complete games, as the reader would index them
+        size_t complete_length(const char *path, size_t length) {
+                RecordFileHeader h;
+                fseek(file, 0, SEEK_SET);
+                if (length < sizeof(h) || fread(&h, sizeof(h), 1, file) != 1)
+                        DIE("not a game record file: " << path);
+                check_record_header(h, path, sizeof(M));
+
+                size_t at = sizeof(h);
+                while (at + sizeof(RecordGameHeader) <= length) {
+                        RecordGameHeader g;
+                        fseek(file, at, SEEK_SET);
+                        if (fread(&g, sizeof(g), 1, file) != 1)
+                                DIE("cannot read " << path << ": " << strerror(errno));
+                        if (g.size < sizeof(g) || at + g.size > length)
+                                break; // cut short
+                        at += g.size;
+                }
+                return at;
+        }
+
+        void append(const void *p, size_t n) {
+                if (n == 0)
+                        return;
+                size_t at = buffer.size();
+                buffer.resize(at + n);
+                memcpy(&buffer[at], p, n);
+        }
+
+        RecordWriter(const RecordWriter &);
+        RecordWriter& operator=(const RecordWriter &);
+};
+
+//-----------------------------------------------------------------------------
+//
+// GameRecord
+//
+// A view of one game inside a mapped file; valid while its reader is open.
+// Moves are read with memcpy, as nothing in the file is aligned.
+//
+//-----------------------------------------------------------------------------
+
+template <typename M>
+struct GameRecord {
+        typedef RecordVisit<M> Visit;
+
+        RecordGameHeader header;
+        const char *data;               // the moves
+        std::vector<const char *> dist; // per move: its visit count, then visits
+
+        GameRecord(const char *p) {
+                memcpy(&header, p, sizeof(header));
+                data = p + sizeof(header);
+                if (has_visits()) {
+                        const char *q = data + header.num_moves * sizeof(M);
+                        dist.resize(header.num_moves);
+                        for (size_t i=0; i < header.num_moves; ++i) {
+                                dist[i] = q;
+                                q += sizeof(uint16_t) + num_visits(i) * sizeof(Visit);
+                        }
+                }
+        }
+
+        uint64_t id() const { return header.id; }
+        float param(Color c) const { return header.params[c == WHITE]; }
+        size_t size() const { return header.num_moves; }
+        Color winner() const { return (Color) header.winner; }
+        bool has_visits() const { return header.flags & RECORD_VISITS; }
+
+        M move(size_t i) const {
+                assert(i < size());
+                M m;
+                memcpy(&m, data + i*sizeof(M), sizeof(M));
+                return m;
+        }
+
+        size_t num_visits(size_t i) const {
+                if (!has_visits())
+                        return 0;
+                uint16_t n;
+                memcpy(&n, dist[i], sizeof(n));
+                return n;
+        }
+
+        Visit visit(size_t i, size_t j) const {
+                assert(j < num_visits(i));
+                Visit v;
+                memcpy(&v, dist[i] + sizeof(uint16_t) + j*sizeof(Visit), sizeof(Visit));
+                return v;
+        }
+};
+
+//-----------------------------------------------------------------------------
+//
+// RecordReader
+//
+// Maps a record file read-only and indexes its games; pages are only read
+// as games are visited, so files larger than memory can be streamed.
+//
+//-----------------------------------------------------------------------------
+
+template <typename M>
+struct RecordReader {
+        typedef GameRecord<M> Record;
+
+        const char *map;
+        size_t length;
+        std::vector<size_t> offsets;
+
+        RecordReader(const char *path) : map(NULL), length(0) {
+                int fd = open(path, O_RDONLY);
+                if (fd < 0)
+                        DIE("cannot open " << path << ": " << strerror(errno));
+                struct stat st;
+                if (fstat(fd, &st) < 0)
+                        DIE("cannot stat " << path << ": " << strerror(errno));
+                length = st.st_size;
+                if (length < sizeof(RecordFileHeader))
+                        DIE("not a game record file: " << path);
+                void *p = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                close(fd);
+                if (p == MAP_FAILED)
+                        DIE("cannot map " << path << ": " << strerror(errno));
+                map = (const char *) p;
+                madvise(p, length, MADV_SEQUENTIAL);
+
+                RecordFileHeader h;
+                memcpy(&h, map, sizeof(h));
+                check_record_header(h, path, sizeof(M));
+
+                size_t at = sizeof(h);
+                while (at + sizeof(RecordGameHeader) <= length) {
+                        RecordGameHeader g;
+                        memcpy(&g, map + at, sizeof(g));
+                        if (g.size < sizeof(g) || at + g.size > length)
+                                break; // truncated
+                        offsets.push_back(at);
+                        at += g.size;
+                }
+        }
+
+        ~RecordReader() {
+                if (map)
+                        munmap((void *) map, length);
+        }
+
+        size_t size() const { return offsets.size(); }
+
+        Record operator [] (size_t i) const {
+                assert(i < size());
+                return Record(map + offsets[i]);
+        }
+
+private:
+        RecordReader(const RecordReader &);
+        RecordReader& operator=(const RecordReader &);
+};
+
+//-----------------------------------------------------------------------------
+//
+// Replay
+//
+// Steps through the positions of a recorded game from S's initial state:
+//
+//      for (Replay<S> r(record); !r.done(); r.advance())
+//              ... r.state, r.move(), r.winner() ...
+//
+// state is the position before move(), with r.player() to move.
+//
+//-----------------------------------------------------------------------------
+
+template <typename S>
+struct Replay {
+        typedef typename S::M M;
+
+        const GameRecord<M> &record;
+        S state;
+        size_t ply;
+
+        Replay(const GameRecord<M> &r) : record(r), ply(0) {
+                state.clear();
+        }
+
+        bool done() const { return ply >= record.size(); }
+        M move() const { return record.move(ply); }
+        Color player() const { return (ply % 2) ? WHITE : BLACK; }
+        Color winner() const { return record.winner(); }
+
+        void advance() {
+                assert(!done());
+                state.move(move());
+                ply++;
+        }
+};
+
+#endif // RECORD_H
@@ -82,7 +82,96 @@ public:
 
                 arma::mat tmp = FO::activation(q.hidden * w2);
                 q.output = tmp.cols(0, NUM_OUTPUT-1);
-                h = tmp.cols(NUM_OUTPUT, NUM_HIDDEN);
+                h = tmp.cols(NUM_OUTPUT, NUM_OUTPUT+NUM_HIDDEN-1);
+        }
+
+
+	//---------------------------------------------------------------------------
+	//
+	// Truncated backpropagation through time
+	//
+	// Trains on a batch of equal length sequences, one sequence per row:
+	// input[t] is batch x NUM_INPUT and target[t] batch x NUM_OUTPUT for
+	// every step t. The memory starts at zero and is carried through the
+	// whole sequence, but gradients only flow back within windows of
+	// `truncate` steps, after each of which the weights are updated. The
+	// per-step activations of a window live in buffers that are allocated
+	// once for a given batch size and window length.
+	//
+	//---------------------------------------------------------------------------
+
+        std::vector<arma::mat> step_input,  // [input, bias, memory]
+                               step_hidden, // with bias column
+                               step_output; // [output, memory]
+        arma::mat dw1, dw2, delta_out, delta_hid, delta_memory, memory;
+
+        void allocate(size_t batch, size_t truncate) {
+                if (step_input.size() == truncate && memory.n_rows == batch)
+                        return;
+                step_input.resize(truncate);
+                step_hidden.resize(truncate);
+                step_output.resize(truncate);
+                for (size_t t=0; t < truncate; ++t) {
+                        step_input[t].set_size(batch, NUM_INPUT+1+NUM_HIDDEN);
+                        step_input[t].col(NUM_INPUT).ones();
+                        step_hidden[t].set_size(batch, NUM_HIDDEN+1);
+                        step_output[t].set_size(batch, NUM_OUTPUT+NUM_HIDDEN);
+                }
+                memory.set_size(batch, NUM_HIDDEN);
+                delta_memory.set_size(batch, NUM_HIDDEN);
+        }
+
+        // returns the summed squared error over all steps
+        double train(const std::vector<arma::mat> &input,
+                     const std::vector<arma::mat> &target,
+                     size_t truncate, double learning_rate) {
+                assert(input.size() == target.size() && input.size() > 0);
+                size_t batch = input[0].n_rows;
+                if (truncate == 0 || truncate > input.size())
+                        truncate = input.size();
+
+                allocate(batch, truncate);
+                memory.zeros();
+
+                double sse = 0;
+                for (size_t start=0; start < input.size(); start += truncate) {
+                        size_t len = std::min(truncate, input.size()-start);
+
+                        // forward through the window
+                        for (size_t k=0; k < len; ++k) {
+                                arma::mat &x = step_input[k];
+                                x.cols(0, NUM_INPUT-1) = input[start+k];
+                                x.cols(NUM_INPUT+1, NUM_INPUT+NUM_HIDDEN) = memory;
+                                step_hidden[k].cols(0, NUM_HIDDEN-1) = FH::activation(x * w1);
+                                step_hidden[k].col(NUM_HIDDEN).ones();
+                                step_output[k] = FO::activation(step_hidden[k] * w2);
+                                memory = step_output[k].cols(NUM_OUTPUT, NUM_OUTPUT+NUM_HIDDEN-1);
+                        }
+
+                        // and back
+                        dw1.zeros(w1.n_rows, w1.n_cols);
+                        dw2.zeros(w2.n_rows, w2.n_cols);
+                        delta_memory.zeros();
+                        for (size_t k=len; k-- > 0; ) {
+                                arma::mat error = target[start+k]
+                                                - step_output[k].cols(0, NUM_OUTPUT-1);
+                                sse += arma::accu(arma::square(error));
+
+                                delta_out = arma::join_rows(error, delta_memory)
+                                          % FO::derivative(step_output[k]);
+                                delta_hid = (delta_out * w2.t()) % FH::derivative(step_hidden[k]);
+                                delta_hid.shed_col(NUM_HIDDEN);
+
+                                dw2 += step_hidden[k].t() * delta_out;
+                                dw1 += step_input[k].t() * delta_hid;
+
+                                delta_memory = (delta_hid * w1.rows(NUM_INPUT+1, NUM_INPUT+NUM_HIDDEN).t());
+                        }
+
+                        w1 += learning_rate * dw1;
+                        w2 += learning_rate * dw2;
+                }
+                return sse;
         }
 };
 
@@ -4,6 +4,7 @@
 
 #include "common.h"
 #include "board.h"
+#include "bitboard.h"
 
 template <size_t SIZE>
 struct SquarePathFinder {
@@ -121,6 +122,7 @@ struct SquarePathFinder {
         bool connected_any(Color c, Board *m) {
                 clear(c, m);
                 if (searchEastWest()) return true;
+                clear(c, m); // the east-west search marks stones seen
                 if (searchNorthSouth()) return true;
                 return false;
         }
@@ -156,4 +158,127 @@ struct SquarePathFinder {
 };
 
 
+//-----------------------------------------------------------------------------
+//
+// BitSquarePathFinder
+//
+// Same interface as SquarePathFinder, but groups are found by iterated
+// shift-and-mask dilation over WideBitboards instead of recursion, so board
+// size does not bound the stack. connected(), longest() and connected_any()
+// keep no state between calls and are safe to share between threads.
+//
+//-----------------------------------------------------------------------------
+
+template <size_t SIZE>
+struct BitSquarePathFinder {
+        typedef board::Square<Color,SIZE> Board;
+        typedef WideBitboard<SIZE,SIZE> BB;
+        Color color;
+        Board *map;
+        BB visited;
+
+        BitSquarePathFinder(int _dummy) : color(NONE), map(0) {}
+
+        bool seen(uint8_t x, uint8_t y) { return visited.get(x,y); }
+
+        void clear(Color c, Board *m) {
+                color = c;
+                map = m;
+                visited.reset();
+        }
+
+        // the board is stored row by row, like the bitboard
+        static BB stones(Color c, const Board *m) {
+                BB b;
+                const Color *p = &m->data[0][0];
+                for (size_t w=0; w < BB::WORDS; ++w, p += 64) {
+                        size_t n = std::min<size_t>(64, SIZE*SIZE - (w<<6));
+                        uint64_t x = 0;
+                        for (size_t i=0; i < n; ++i)
+                                x |= uint64_t(p[i] == c) << i;
+                        b.data[w] = x;
+                }
+                return b;
+        }
+
+        // grow from the stones on one edge, stopping as soon as the opposite
+        // edge is reached
+        static bool connects(const BB &mine, const BB &from, const BB &to) {
+                BB group = mine & from;
+                for (;;) {
+                        if ((group & to).any())
+                                return true;
+                        BB next = group.dilate4() & mine;
+                        if (next == group)
+                                return false;
+                        group = next;
+                }
+        }
+
+        static bool connected_east_west(const BB &mine) {
+                static const BB west = BB::make_column(0),
+                                east = BB::make_column(SIZE-1);
+                return connects(mine, west, east);
+        }
+
+        static bool connected_north_south(const BB &mine) {
+                static const BB north = BB::make_row(0),
+                                south = BB::make_row(SIZE-1);
+                return connects(mine, north, south);
+        }
+
+        bool connected(Color c, Board *m) {
+                BB mine = stones(c, m);
+                if (c == WHITE)
+                        return connected_east_west(mine);
+                return connected_north_south(mine);
+        }
+
+        size_t longest(Color c, Board *m) {
+                BB rest = stones(c, m);
+                size_t best = 0;
+
+                // single stones in one step
+                BB single = rest.andnot(rest.neighbours4());
+                if (single.any()) {
+                        best = 1;
+                        rest = rest.andnot(single);
+                }
+
+                // stop once no remaining group can be longer
+                while (rest.count() > best) {
+                        BB seed;
+                        seed.set(rest.first());
+                        BB group = BB::fill4(seed, rest);
+                        size_t len = group.count();
+                        if (len > best)
+                                best = len;
+                        rest = rest.andnot(group);
+                }
+                return best;
+        }
+
+        bool connected_any(Color c, Board *m) {
+                BB mine = stones(c, m);
+                return connected_east_west(mine) || connected_north_south(mine);
+        }
+
+        // empty points next to the group at (x,y), or 1 if (x,y) is empty;
+        // the group is marked as seen
+        size_t liberties(uint8_t x, uint8_t y, Board *m) {
+                clear(m->get(x,y), m);
+                if (color == NONE) {
+                        visited.set(x,y);
+                        return 1;
+                }
+
+                BB seed;
+                seed.set(x,y);
+                BB group = BB::fill4(seed, stones(color, m));
+                visited |= group;
+                return (group.dilate4() & stones(NONE, m)).count();
+        }
+};
+
+
 #endif // SEARCH_H
@@ -0,0 +1,198 @@
+#ifndef SIMD_H
+#define SIMD_H
+#pragma once
+
+#include "common.h"
+
+#include <stdlib.h>
+
+#if defined(__AVX__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+//-----------------------------------------------------------------------------
+//
+// Vector kernels
+//
+// Used by the inference paths of the networks. Lengths are expected to be a
+// multiple of SIMD_FLOATS (see SIMD_PAD), or of 16 for the integer dot
+// product (SIMD_PAD16), with 32 byte aligned arrays, so the AVX loops need
+// no tail handling; the scalar versions are used when the compiler is not
+// targeting AVX (e.g. -march=native is not given).
+//
+//-----------------------------------------------------------------------------
+
+#define SIMD_ALIGN  32
+#define SIMD_FLOATS 8
+#define SIMD_PAD(n) (((n) + SIMD_FLOATS-1) & ~size_t(SIMD_FLOATS-1))
+#define SIMD_PAD16(n) (((n) + 15) & ~size_t(15))
+
+namespace simd {
+
+// sum of a[i]*b[i]
+static inline float dot(const float *a, const float *b, size_t n) {
+#ifdef __AVX__
+        __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+        size_t i=0;
+        for (; i+16 <= n; i += 16) {
+#ifdef __FMA__
+                s0 = _mm256_fmadd_ps(_mm256_load_ps(a+i), _mm256_load_ps(b+i), s0);
+                s1 = _mm256_fmadd_ps(_mm256_load_ps(a+i+8), _mm256_load_ps(b+i+8), s1);
+#else
+                s0 = _mm256_add_ps(s0, _mm256_mul_ps(_mm256_load_ps(a+i), _mm256_load_ps(b+i)));
+                s1 = _mm256_add_ps(s1, _mm256_mul_ps(_mm256_load_ps(a+i+8), _mm256_load_ps(b+i+8)));
+#endif
+        }
+        for (; i < n; i += 8)
+                s0 = _mm256_add_ps(s0, _mm256_mul_ps(_mm256_load_ps(a+i), _mm256_load_ps(b+i)));
+        s0 = _mm256_add_ps(s0, s1);
+        __m128 h = _mm_add_ps(_mm256_castps256_ps128(s0), _mm256_extractf128_ps(s0, 1));
+        h = _mm_add_ps(h, _mm_movehl_ps(h, h));
+        h = _mm_add_ss(h, _mm_shuffle_ps(h, h, 1));
+        return _mm_cvtss_f32(h);
+#else
+        float s = 0;
+        for (size_t i=0; i < n; ++i)
+                s += a[i] * b[i];
+        return s;
+#endif
+}
+
+// y += a*x
+static inline void axpy(float a, const float *x, float *y, size_t n) {
+#ifdef __AVX__
+        __m256 va = _mm256_set1_ps(a);
+        for (size_t i=0; i < n; i += 8) {
+#ifdef __FMA__
+                _mm256_store_ps(y+i, _mm256_fmadd_ps(va, _mm256_load_ps(x+i), _mm256_load_ps(y+i)));
+#else
+                _mm256_store_ps(y+i, _mm256_add_ps(_mm256_load_ps(y+i),
+                                                   _mm256_mul_ps(va, _mm256_load_ps(x+i))));
+#endif
+        }
+#else
+        for (size_t i=0; i < n; ++i)
+                y[i] += a * x[i];
+#endif
+}
+
+// y += x
+static inline void add(const float *x, float *y, size_t n) {
+#ifdef __AVX__
+        for (size_t i=0; i < n; i += 8)
+                _mm256_store_ps(y+i, _mm256_add_ps(_mm256_load_ps(y+i), _mm256_load_ps(x+i)));
+#else
+        for (size_t i=0; i < n; ++i)
+                y[i] += x[i];
+#endif
+}
+
+// y -= x
+static inline void sub(const float *x, float *y, size_t n) {
+#ifdef __AVX__
+        for (size_t i=0; i < n; i += 8)
+                _mm256_store_ps(y+i, _mm256_sub_ps(_mm256_load_ps(y+i), _mm256_load_ps(x+i)));
+#else
+        for (size_t i=0; i < n; ++i)
+                y[i] -= x[i];
+#endif
+}
+
+// sum of a[i]*b[i] with int32 accumulation; n a multiple of 16
+static inline int32_t dot(const int16_t *a, const int8_t *b, size_t n) {
+#ifdef __AVX2__
+        __m256i s = _mm256_setzero_si256();
+        for (size_t i=0; i < n; i += 16) {
+                __m256i w = _mm256_cvtepi8_epi16(_mm_load_si128((const __m128i *) (b+i)));
+                s = _mm256_add_epi32(s, _mm256_madd_epi16(_mm256_load_si256((const __m256i *) (a+i)), w));
+        }
+        __m128i h = _mm_add_epi32(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+        h = _mm_add_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(1,0,3,2)));
+        h = _mm_add_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(2,3,0,1)));
+        return _mm_cvtsi128_si32(h);
+#else
+        int32_t s = 0;
+        for (size_t i=0; i < n; ++i)
+                s += int32_t(a[i]) * int32_t(b[i]);
+        return s;
+#endif
+}
+
+// four dot products of a with the rows b, b+stride, b+2*stride, b+3*stride,
+// sharing the loads of a
+static inline void dot4(const int16_t *a, const int8_t *b, size_t stride, size_t n, int32_t *out) {
+#ifdef __AVX2__
+        __m256i s0 = _mm256_setzero_si256(), s1 = s0, s2 = s0, s3 = s0;
+        for (size_t i=0; i < n; i += 16) {
+                __m256i x = _mm256_load_si256((const __m256i *) (a+i));
+#define DOT4_ROW(s, r) \
+                s = _mm256_add_epi32(s, _mm256_madd_epi16(x, \
+                        _mm256_cvtepi8_epi16(_mm_load_si128((const __m128i *) (b + r*stride + i)))));
+                DOT4_ROW(s0, 0) DOT4_ROW(s1, 1) DOT4_ROW(s2, 2) DOT4_ROW(s3, 3)
+#undef DOT4_ROW
+        }
+        __m256i h = _mm256_hadd_epi32(_mm256_hadd_epi32(s0, s1), _mm256_hadd_epi32(s2, s3));
+        __m128i r = _mm_add_epi32(_mm256_castsi256_si128(h), _mm256_extracti128_si256(h, 1));
+        _mm_storeu_si128((__m128i *) out, r);
+#else
+        for (size_t r=0; r < 4; ++r)
+                out[r] = dot(a, b + r*stride, n);
+#endif
+}
+
+} // namespace simd
+
+
+//-----------------------------------------------------------------------------
+//
+// AlignedBuffer
+//
+// Heap array aligned for the kernels above, allocated once and zero filled,
+// so padding lanes contribute nothing to dot products. Copies are deep.
+//
+//-----------------------------------------------------------------------------
+
+template <typename T>
+struct AlignedBuffer {
+        T *data;
+        size_t n;
+
+        AlignedBuffer() : data(0), n(0) {}
+        AlignedBuffer(size_t size) : data(0), n(0) { resize(size); }
+        AlignedBuffer(const AlignedBuffer &rhs) : data(0), n(0) { *this = rhs; }
+        ~AlignedBuffer() { free(data); }
+
+        AlignedBuffer& operator=(const AlignedBuffer &rhs) {
+                if (this != &rhs) {
+                        resize(rhs.n);
+                        if (n)
+                                memcpy(data, rhs.data, n * sizeof(T));
+                }
+                return *this;
+        }
+
+        void resize(size_t size) {
+                if (size == n) {
+                        clear();
+                        return;
+                }
+                free(data);
+                data = 0;
+                n = size;
+                if (n == 0)
+                        return;
+                void *p = 0;
+                if (posix_memalign(&p, SIMD_ALIGN, n * sizeof(T)) != 0)
+                        DIE("could not allocate " << n * sizeof(T) << " aligned bytes");
+                data = (T *) p;
+                clear();
+        }
+
+        void clear() { if (n) memset(data, 0, n * sizeof(T)); }
+        size_t size() const { return n; }
+
+        T& operator[](size_t i) { return data[i]; }
+        const T& operator[](size_t i) const { return data[i]; }
+};
+
+#endif // SIMD_H
@@ -0,0 +1,141 @@
+#ifndef STATS_H
+#define STATS_H
+#pragma once
+
+#include "common.h"
+#include "thread.h"
+
+//-----------------------------------------------------------------------------
+//
+// Search statistics
+//
+// Counters kept by the engines when built with STATS; without it the STATS_*
+// macros compile to nothing and engines carry no stats member.
+//
+// Search threads count into a thread-local SearchCounters with no locking;
+// STATS_GATHER adds a thread's counts to an engine's SearchStats (under the
+// engine's mutex) and zeroes them, so each task gathers once when it ends.
+// At the end of a move, STATS_END_MOVE logs the move's stats (unless
+// STATS_LOG is cleared, e.g. by the batch driver) and adds them to
+// SearchStats::total(), the sum over all moves and engines.
+//
+// Times are wall-clock seconds summed over threads.
+//
+//-----------------------------------------------------------------------------
+
+struct SearchCounters {
+        uint64_t moves,         // searches gathered
+                 playouts,
+                 expanded,      // tree nodes added
+                 depth,         // sum of selection depths, over playouts
+                 max_depth,
+                 pool_used,     // of the node pool, at the end of the move
+                 pool_size,
+                 nodes,         // visited by minimax
+                 cutoffs,
+                 movegen,       // calls to S::moves
+                 rollout_moves;
+        double select, expand, rollout, backprop;
+
+        void clear() { memset(this, 0, sizeof(*this)); }
+
+        void add(const SearchCounters &c) {
+                moves += c.moves;
+                playouts += c.playouts;
+                expanded += c.expanded;
+                depth += c.depth;
+                max_depth = std::max(max_depth, c.max_depth);
+                pool_used += c.pool_used;
+                pool_size += c.pool_size;
+                nodes += c.nodes;
+                cutoffs += c.cutoffs;
+                movegen += c.movegen;
+                rollout_moves += c.rollout_moves;
+                select += c.select;
+                expand += c.expand;
+                rollout += c.rollout;
+                backprop += c.backprop;
+        }
+};
+
+struct SearchStats : SearchCounters {
+        SearchStats() { clear(); }
+
+        double ratio(uint64_t n, uint64_t d) const { return d ? double(n) / d : 0; }
+
+        void write(ostream &o, const char *engine) const {
+                o << engine << ": moves=" << moves
+                  << " playouts=" << playouts
+                  << " expanded=" << expanded
+                  << " depth avg=" << ratio(depth, playouts) << " max=" << max_depth
+                  << " pool=" << pool_used << '/' << pool_size
+                  << " nodes=" << nodes
+                  << " cutoffs=" << cutoffs
+                  << " movegen=" << movegen
+                  << " rollout=" << ratio(rollout_moves, playouts)
+                  << " time select=" << select << " expand=" << expand
+                  << " rollout=" << rollout << " backprop=" << backprop;
+        }
+
+        void report(const char *engine) const {
+                stringstream s;
+                write(s, engine);
+                LOG(s.str());
+        }
+
+        static SearchStats &total() {
+                static SearchStats t;
+                return t;
+        }
+};
+
+// adds the time between construction and destruction to a counter
+struct StatsTimer {
+        double &seconds;
+        Stopwatch sw;
+        StatsTimer(double &s) : seconds(s) {}
+        ~StatsTimer() { seconds += sw.elapsed(); }
+};
+
+#ifdef STATS
+
+static Mutex STATS_MUTEX;
+static bool STATS_LOG = true;
+static __thread SearchCounters THREAD_STATS;
+
+static inline void stats_gather(SearchStats &into, Mutex &mutex) {
+        { Lock lock(mutex);
+                into.add(THREAD_STATS);
+        }
+        THREAD_STATS.clear();
+}
+
+static inline void stats_end_move(SearchStats &s, const char *engine) {
+        s.moves = 1;
+        if (STATS_LOG)
+                s.report(engine);
+        Lock lock(STATS_MUTEX);
+        SearchStats::total().add(s);
+}
+
+#define STATS_INC(f)            (THREAD_STATS.f++)
+#define STATS_ADD(f, n)         (THREAD_STATS.f += (n))
+#define STATS_MAX(f, n)         { uint64_t _n = (n); if (_n > THREAD_STATS.f) THREAD_STATS.f = _n; }
+#define STATS_TIME(f)           StatsTimer _stats_timer(THREAD_STATS.f)
+#define STATS_GATHER(s, m)      stats_gather(s, m)
+#define STATS_END_MOVE(s, e)    stats_end_move(s, e)
+#define STATS_ONLY(x)           x
+
+#else
+
+#define STATS_INC(f)
+#define STATS_ADD(f, n)
+#define STATS_MAX(f, n)
+#define STATS_TIME(f)
+#define STATS_GATHER(s, m)
+#define STATS_END_MOVE(s, e)
+#define STATS_ONLY(x)
+
+#endif // STATS
+
+#endif // STATS_H
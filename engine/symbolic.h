@@ -3,13 +3,21 @@
 #pragma once
 
 #include "common.h"
+#include "memory.h"
+#include "simd.h"
+
+#include <vector>
+#include <algorithm>
 
 struct DefaultAllocator {
         template <typename T> static T* alloc() { return new T; }
         template <typename T> static void release(T *n) { delete n; }
 };
 
-struct Node {
+// Nodes are ArenaObjects: built while an ArenaScope is active they come from
+// that arena, and trees from it are dropped with Arena::clear() rather than
+// deleted (see release()).
+struct Node : ArenaObject {
         typedef long double value_t;
 
         enum Type {
@@ -22,9 +30,16 @@ struct Node {
 
         enum Arity { NULLARY, UNARY, BINARY, TERNARY }; 
         Arity arity;
-        Node(Arity a) : arity(a) {}
+        unsigned id; // ExprTable index + 1, 0 when not interned
+        Node(Arity a) : arity(a), id(0) {}
         virtual ~Node() {}
 
+        // frees a tree unless it lives in an arena
+        static void release(Node *n) {
+                if (n && !from_arena(n))
+                        delete n;
+        }
+
 
         virtual bool has_variable() const { return false; }
         virtual Node *simplify() const { return deep_copy(); }
@@ -268,4 +283,424 @@ BIN_OP(Fmod, FMOD,
        "(fmod " << a->sexpr() << ' ' << b->sexpr() << ')',
        "fmod(" << a->str() << "," << b->str() << ')');
 
+
+
+//-----------------------------------------------------------------------------
+//
+// Program
+//
+// A Node tree compiled to postfix bytecode. run_array() evaluates it for a
+// whole array of values of one variable, an instruction at a time over
+// blocks of BLOCK doubles on a stack of blocks, so the arithmetic loops
+// vectorise. It is the only fast path: for a single value, call the tree's
+// eval(), as a scalar interpreter in value_t was measured no faster than
+// the virtual calls (long double goes through memory on every step).
+// run_array() computes in double, not value_t: results differ from eval()
+// in the last bits, and by more where an expression amplifies rounding
+// (floor, fmod, pow near a jump), so fitness computed with it can differ
+// from eval()'s and break ties in compare() differently.
+//
+// Differential nodes have no bytecode and fall back to eval() on their
+// subtree, so the tree must outlive the program. The block stack is a
+// member: use one Program per thread.
+//
+//-----------------------------------------------------------------------------
+
+struct Program {
+        typedef Node::value_t value_t;
+
+        enum { BLOCK = 64 };
+
+        struct Instruction {
+                Node::Type op;
+                value_t value;         // CONSTANT
+                value_t *var;          // VARIABLE
+                const Node *node;      // DIFFERENTIAL, evaluated by the tree
+        };
+
+        vector<Instruction> code;
+        size_t depth;
+        AlignedBuffer<double> block_stack;
+
+        Program() : depth(0) {}
+        Program(const Node *n) : depth(0) { compile(n); }
+
+        void compile(const Node *n) {
+                code.clear();
+                depth = 0;
+                size_t d = 0;
+                emit(n, d);
+        }
+
+        void push(const Instruction &i, size_t &d) {
+                code.push_back(i);
+                if (++d > depth)
+                        depth = d;
+        }
+
+        void emit(const Node *n, size_t &d) {
+                Instruction i;
+                i.op = n->type();
+                i.value = 0;
+                i.var = 0;
+                i.node = 0;
+
+                switch (i.op) {
+                case Node::CONSTANT:
+                        i.value = ((const Constant *) n)->value;
+                        push(i, d);
+                        return;
+                case Node::VARIABLE:
+                        i.var = ((const Variable *) n)->var;
+                        push(i, d);
+                        return;
+                case Node::DIFFERENTIAL:
+                        i.node = n;
+                        push(i, d);
+                        return;
+                default:
+                        break;
+                }
+
+                if (n->arity == Node::UNARY) {
+                        emit(((const Unary *) n)->n, d);
+                        code.push_back(i);
+                } else if (n->arity == Node::BINARY) {
+                        emit(((const Binary *) n)->a, d);
+                        emit(((const Binary *) n)->b, d);
+                        code.push_back(i);
+                        --d;
+                } else {
+                        DIE("cannot compile node type " << i.op);
+                }
+        }
+
+        size_t size() const { return code.size(); }
+
+        // result of a unary (b unused) or binary operator
+        static value_t apply(Node::Type op, value_t a, value_t b) {
+                switch (op) {
+                case Node::NEGATE:   return -a;
+                case Node::LOGN:     return log(a);
+                case Node::SQRT:     return sqrt(a);
+                case Node::EXP:      return exp(a);
+                case Node::FLOOR:    return floor(a);
+                case Node::CEIL:     return ceil(a);
+                case Node::SIGN:     return sgn(a);
+                case Node::SIN:      return sin(a);
+                case Node::COS:      return cos(a);
+                case Node::TAN:      return tan(a);
+                case Node::ADD:      return a + b;
+                case Node::SUBTRACT: return a - b;
+                case Node::MULTIPLY: return a * b;
+                case Node::DIVIDE:   return a / b;
+                case Node::POWER:    return pow(a, b);
+                case Node::FMOD:     return fmod(a, b);
+                default: DIE("bad opcode " << op);
+                }
+        }
+
+#define PROGRAM_UNARY(F) { \
+                double *a = &block_stack[(top-1)*BLOCK]; \
+                for (size_t k=0; k < m; ++k) a[k] = F(a[k]); \
+                break; }
+#define PROGRAM_BINARY(E) { \
+                --top; \
+                double *__restrict a = &block_stack[(top-1)*BLOCK]; \
+                const double *__restrict b = a + BLOCK; \
+                for (size_t k=0; k < m; ++k) a[k] = E; \
+                break; }
+
+        // out[k] = program with *var = values[k], for k < n
+        void run_array(value_t *var, const double *values, double *out, size_t n) {
+                if (block_stack.size() < depth * BLOCK)
+                        block_stack.resize(depth * BLOCK);
+
+                for (size_t first=0; first < n; first += BLOCK) {
+                        size_t m = std::min<size_t>(BLOCK, n-first);
+                        const double *x = values + first;
+                        size_t top = 0; // blocks on the stack
+
+                        for (size_t pc=0; pc < code.size(); ++pc) {
+                                const Instruction &i = code[pc];
+                                double *t = &block_stack[top*BLOCK];
+
+                                switch (i.op) {
+                                case Node::CONSTANT:
+                                        for (size_t k=0; k < m; ++k) t[k] = i.value;
+                                        ++top;
+                                        break;
+                                case Node::VARIABLE:
+                                        if (i.var == var) {
+                                                for (size_t k=0; k < m; ++k) t[k] = x[k];
+                                        } else {
+                                                double v = *i.var;
+                                                for (size_t k=0; k < m; ++k) t[k] = v;
+                                        }
+                                        ++top;
+                                        break;
+                                case Node::DIFFERENTIAL: {
+                                        value_t saved = *var;
+                                        for (size_t k=0; k < m; ++k) {
+                                                *var = x[k];
+                                                t[k] = i.node->eval();
+                                        }
+                                        *var = saved;
+                                        ++top;
+                                        break;
+                                }
+
+                                case Node::NEGATE: PROGRAM_UNARY(-)
+                                case Node::LOGN:   PROGRAM_UNARY(log)
+                                case Node::SQRT:   PROGRAM_UNARY(sqrt)
+                                case Node::EXP:    PROGRAM_UNARY(exp)
+                                case Node::FLOOR:  PROGRAM_UNARY(floor)
+                                case Node::CEIL:   PROGRAM_UNARY(ceil)
+                                case Node::SIGN:   PROGRAM_UNARY(sgn)
+                                case Node::SIN:    PROGRAM_UNARY(sin)
+                                case Node::COS:    PROGRAM_UNARY(cos)
+                                case Node::TAN:    PROGRAM_UNARY(tan)
+
+                                case Node::ADD:      PROGRAM_BINARY(a[k] + b[k])
+                                case Node::SUBTRACT: PROGRAM_BINARY(a[k] - b[k])
+                                case Node::MULTIPLY: PROGRAM_BINARY(a[k] * b[k])
+                                case Node::DIVIDE:   PROGRAM_BINARY(a[k] / b[k])
+                                case Node::POWER:    PROGRAM_BINARY(pow(a[k], b[k]))
+                                case Node::FMOD:     PROGRAM_BINARY(fmod(a[k], b[k]))
+
+                                default: DIE("bad opcode " << i.op);
+                                }
+                        }
+
+                        memcpy(out + first, &block_stack[0], m * sizeof(double));
+                }
+        }
+
+#undef PROGRAM_UNARY
+#undef PROGRAM_BINARY
+};
+
+
+//-----------------------------------------------------------------------------
+//
+// ExprTable
+//
+// Hash-consed expressions. intern() returns the table's copy of a tree, built
+// bottom up so structurally equal subtrees are one shared node; copying an
+// interned tree is copying its root pointer. Shared nodes are immutable and
+// belong to the table: they are allocated from its arena and go away with
+// clear(), never delete or modify them. eval() caches node values for one
+// call, so a subtree that occurs several times is evaluated once.
+//
+//-----------------------------------------------------------------------------
+
+static const uint64_t HASH_BASIS = 0xcbf29ce484222325ULL;
+
+static inline uint64_t hash_mix(uint64_t h, uint64_t v) {
+        return (h ^ v) * 0x100000001b3ULL;
+}
+
+static inline uint64_t hash_value(Node::value_t value) {
+        double v = value;
+        uint64_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        return bits;
+}
+
+struct ExprTable {
+        typedef Node::value_t value_t;
+
+        Arena arena;
+        vector<const Node *> nodes;  // by id-1
+        vector<unsigned> buckets,    // first id of the chain, 0 if empty
+                              chain;      // next id, by id-1
+        vector<value_t> values;      // eval() cache, by id-1
+        vector<unsigned> stamps;     // values[i] is valid if stamps[i] == epoch
+        unsigned epoch;
+
+        ExprTable() : buckets(1024, 0), epoch(0) {}
+
+        size_t size() const { return nodes.size(); }
+
+        bool owns(const Node *n) const {
+                return n->id && n->id <= nodes.size() && nodes[n->id-1] == n;
+        }
+
+        // a, b are the interned children
+        static uint64_t hash(const Node *n, const Node *a, const Node *b) {
+                uint64_t h = hash_mix(HASH_BASIS, n->type());
+                if (n->type() == Node::CONSTANT)
+                        h = hash_mix(h, hash_value(((const Constant *) n)->value));
+                else if (n->type() == Node::VARIABLE) {
+                        h = hash_mix(h, (size_t) ((const Variable *) n)->var);
+                }
+                if (a) h = hash_mix(h, a->id);
+                if (b) h = hash_mix(h, b->id);
+                return h ^ (h >> 29);
+        }
+
+        static bool same(const Node *x, const Node *n, const Node *a, const Node *b) {
+                if (x->type() != n->type())
+                        return false;
+                switch (x->arity) {
+                case Node::UNARY:  return ((const Unary *) x)->n == a;
+                case Node::BINARY: return ((const Binary *) x)->a == a && ((const Binary *) x)->b == b;
+                default: break;
+                }
+                if (x->type() == Node::CONSTANT)
+                        return ((const Constant *) x)->value == ((const Constant *) n)->value;
+                return ((const Variable *) x)->var == ((const Variable *) n)->var;
+        }
+
+        const Node *intern(const Node *n) {
+                if (owns(n))
+                        return n;
+
+                const Node *a = 0, *b = 0;
+                if (n->arity == Node::UNARY) {
+                        a = intern(((const Unary *) n)->n);
+                } else if (n->arity == Node::BINARY) {
+                        a = intern(((const Binary *) n)->a);
+                        b = intern(((const Binary *) n)->b);
+                }
+
+                uint64_t h = hash(n, a, b);
+                for (unsigned id = buckets[h & (buckets.size()-1)]; id; id = chain[id-1])
+                        if (same(nodes[id-1], n, a, b))
+                                return nodes[id-1];
+
+                Node *x;
+                {
+                        ArenaScope scope(&arena);
+                        x = n->copy();
+                }
+                if (x->arity == Node::UNARY) {
+                        ((Unary *) x)->n = const_cast<Node *>(a);
+                } else if (x->arity == Node::BINARY) {
+                        ((Binary *) x)->a = const_cast<Node *>(a);
+                        ((Binary *) x)->b = const_cast<Node *>(b);
+                }
+                nodes.push_back(x);
+                x->id = nodes.size();
+                chain.push_back(0);
+                values.push_back(0);
+                stamps.push_back(0);
+                link(x->id, h);
+                if (nodes.size() > buckets.size())
+                        rehash();
+                return x;
+        }
+
+        void link(unsigned id, uint64_t h) {
+                unsigned &head = buckets[h & (buckets.size()-1)];
+                chain[id-1] = head;
+                head = id;
+        }
+
+        void rehash() {
+                buckets.assign(buckets.size() * 2, 0);
+                for (size_t i=0; i < nodes.size(); ++i) {
+                        const Node *x = nodes[i], *a = 0, *b = 0;
+                        if (x->arity == Node::UNARY) {
+                                a = ((const Unary *) x)->n;
+                        } else if (x->arity == Node::BINARY) {
+                                a = ((const Binary *) x)->a;
+                                b = ((const Binary *) x)->b;
+                        }
+                        link(x->id, hash(x, a, b));
+                }
+        }
+
+        // the value of an interned tree with the current variable values
+        value_t eval(const Node *n) {
+                if (++epoch == 0) {
+                        stamps.assign(stamps.size(), 0);
+                        epoch = 1;
+                }
+                return cached(n);
+        }
+
+        value_t cached(const Node *n) {
+                size_t i = n->id-1;
+                if (stamps[i] == epoch)
+                        return values[i];
+
+                value_t v;
+                if (n->type() == Node::DIFFERENTIAL || n->arity == Node::NULLARY)
+                        v = n->eval();
+                else if (n->arity == Node::UNARY)
+                        v = Program::apply(n->type(), cached(((const Unary *) n)->n), 0);
+                else
+                        v = Program::apply(n->type(), cached(((const Binary *) n)->a),
+                                                      cached(((const Binary *) n)->b));
+                values[i] = v;
+                stamps[i] = epoch;
+                return v;
+        }
+
+        void clear() {
+                nodes.clear();
+                chain.clear();
+                values.clear();
+                stamps.clear();
+                buckets.assign(1024, 0);
+                epoch = 0;
+                arena.clear();
+        }
+};
+
+
+//-----------------------------------------------------------------------------
+//
+// canonical_hash
+//
+// Hash of the function a tree computes, as far as that is cheap to tell:
+// variable-free subtrees are folded to their value, the operands of + and *
+// are unordered, and variables are identified by name since pools bind them
+// to different storage. Trees that simplify() to the same tree hash the same,
+// as do e.g. (x+(2*3)) and (6+x).
+//
+//-----------------------------------------------------------------------------
+
+static inline uint64_t canonical_hash(const Node *n, bool &constant, Node::value_t &value) {
+        if (n->is_variable()) {
+                constant = false;
+                uint64_t h = hash_mix(HASH_BASIS, Node::VARIABLE);
+                for (const char *c = ((const Variable *) n)->name; *c; ++c)
+                        h = hash_mix(h, *c);
+                return h;
+        }
+
+        if (n->arity == Node::NULLARY) {
+                constant = true;
+                value = n->eval();
+        } else if (n->arity == Node::UNARY) {
+                uint64_t h = canonical_hash(((const Unary *) n)->n, constant, value);
+                if (!constant)
+                        return hash_mix(hash_mix(HASH_BASIS, n->type()), h);
+                value = n->type() == Node::DIFFERENTIAL ? n->eval()
+                                                        : Program::apply(n->type(), value, 0);
+        } else {
+                bool ka, kb;
+                Node::value_t va, vb;
+                uint64_t ha = canonical_hash(((const Binary *) n)->a, ka, va),
+                         hb = canonical_hash(((const Binary *) n)->b, kb, vb);
+                constant = ka && kb;
+                if (!constant) {
+                        if ((n->type() == Node::ADD || n->type() == Node::MULTIPLY) && ha > hb)
+                                std::swap(ha, hb);
+                        return hash_mix(hash_mix(hash_mix(HASH_BASIS, n->type()), ha), hb);
+                }
+                value = Program::apply(n->type(), va, vb);
+        }
+        return hash_mix(hash_mix(HASH_BASIS, Node::CONSTANT), hash_value(value));
+}
+
+static inline uint64_t canonical_hash(const Node *n) {
+        bool constant;
+        Node::value_t value;
+        uint64_t h = canonical_hash(n, constant, value);
+        return h ^ (h >> 29);
+}
+
 #endif // SYMBOLIC_H
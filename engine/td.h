@@ -4,7 +4,13 @@
 
 #include "common.h"
 #include "neural.h"
+#include "pipeline.h"
+#if defined(HINTON) && defined(HEADLESS)
+#undef HINTON
+#endif
+#ifdef HINTON
 #include "../ui/nn.h"
+#endif
 
 #include <stack>
 #include <algorithm>
@@ -55,60 +61,81 @@ struct TD {
         {
         }
 
-        struct Result {
-                size_t index;
-                Q q;
+        //-------------------------------------------------------------------
+        //
+        // Candidate evaluation
+        //
+        // The hidden pre-activations of the position to move from are kept
+        // in an accumulator; a child is scored by adding the w1 rows of the
+        // cells its move changed, so each candidate costs O(changed cells *
+        // NUM_HIDDEN) rather than a full first layer. Only the chosen move is
+        // replayed through the armadillo net when its query is needed for
+        // training.
+        //
+        //-------------------------------------------------------------------
+
+        AlignedBuffer<float> root_input, root_hidden, child_hidden;
+        vector<double> scores;
+
+        void refresh(S &state) {
+                if (!net.compiled)
+                        net.compile(); // weights changed by learn()
+                if (root_input.size() == 0) {
+                        root_input.resize(SIZE);
+                        root_hidden.resize(NN::HIDDEN_STRIDE);
+                        child_hidden.resize(NN::HIDDEN_STRIDE);
+                }
+                for (size_t j=0; j < SIZE; ++j)
+                        root_input[j] = state[j];
+                net.fprop_hidden(&root_input[0], &root_hidden[0]);
+        }
 
-                double score() { return q.output(0,0) >= 0 ? q.output(0,0) : 0; }
-        };
+        double evaluate(S &child) {
+                memcpy(&child_hidden[0], &root_hidden[0], NN::HIDDEN_STRIDE*sizeof(float));
+                for (size_t j=0; j < SIZE; ++j) {
+                        float v = child[j];
+                        if (v != root_input[j])
+                                net.accumulate(&child_hidden[0], j, v - root_input[j]);
+                }
+                float output;
+                net.fprop_output(&child_hidden[0], &output);
+                return output >= 0 ? output : 0;
+        }
 
-        struct Task {
-                size_t index;
-                NN *net;
+        Q query(S &state, const M &m) {
+                Q q(1);
                 S child;
-                Q q;
-
-                void operator() (Result &result) {
-
-                        for (size_t j=0; j < SIZE; ++j)
-                                q.input(0, j) = child[j];
-
-                        net->fprop(q);
-
-                        result.index = index;
-                        result.q = q;
-                }
-        };
+                child.copy_from(state);
+                child.move(m);
+                for (size_t j=0; j < SIZE; ++j)
+                        q.input(0, j) = child[j];
+                net.fprop(q);
+                return q;
+        }
 
         size_t choose(Color c, S &state, ML &ml) {
                 assert(ml.size() > 0);
 
-                TaskPool<Task,Result> tasks(NUM_THREADS);
-
-                typename NN::Query q(1);
+                refresh(state);
+                scores.resize(ml.size());
+                S child;
                 for (size_t i=0; i < ml.size(); ++i) {
-                        Task task;
-                        task.q = q;
-                        task.index = i;
-                        task.net = &net;
-                        task.child.copy_from(state);
-                        task.child.move(ml[i]);
-                        tasks.push(task);
+                        child.copy_from(state);
+                        child.move(ml[i]);
+                        scores[i] = evaluate(child);
                 }
 
-                tasks.run();
-
                 if (training_mode) {
                         double sum=0;
                         for (size_t i=0; i < ml.size(); ++i)
-                                sum += tasks[i].score();
+                                sum += scores[i];
                         double r = (randf()+1/2) * sum;
                         for (size_t i=0; i < ml.size(); ++i) {
-                                if (r < tasks[i].score()) {
-                                        history.push_back(tasks[i].q);
-                                        return tasks[i].index;
+                                if (r < scores[i]) {
+                                        history.push_back(query(state, ml[i]));
+                                        return i;
                                 }
-                                r -= tasks[i].score();
+                                r -= scores[i];
                         }
                         DIE("notreached");
                 }
@@ -120,15 +147,15 @@ struct TD {
 
                 double sum=0;
                 for (size_t i=0; i < ml.size(); ++i) {
-                        sum += tasks[i].score();
-                        if (tasks[i].score() > highest) {
-                                highest = tasks[i].score();
-                                highest_idx = tasks[i].index;
+                        sum += scores[i];
+                        if (scores[i] > highest) {
+                                highest = scores[i];
+                                highest_idx = i;
                         }
 
-                        if (tasks[i].score() < lowest) {
-                                lowest = tasks[i].score();
-                                lowest_idx = tasks[i].index;
+                        if (scores[i] < lowest) {
+                                lowest = scores[i];
+                                lowest_idx = i;
                         }
                 }
 
@@ -141,15 +168,13 @@ struct TD {
                 }
 
                 for (size_t i=0; i < ml.size(); ++i) {
-#if 1
-                        if (!training_mode && tasks[i].score() > 0)
-                                LOG("i=" << i <<
-                                    " score=" << (double)tasks[i].score()/sum <<
-                                    " move=" << ml[i].str());
-#endif
+                        if (!training_mode && scores[i] > 0)
+                                DEBUG("i=" << i <<
+                                      " score=" << (double)scores[i]/sum <<
+                                      " move=" << ml[i].str());
                         vector<size_t> choices;
-                        if (tasks[i].score() == best)
-                                choices.push_back(tasks[i].index);
+                        if (scores[i] == best)
+                                choices.push_back(i);
                         if (choices.size() > 1)
                                 choice = choices[random() % choices.size()];
                 }
@@ -157,7 +182,7 @@ struct TD {
                 if (training_mode) {
                         if (randf() < greedy)
                                 choice = random() % ml.size();
-                        history.push_back(tasks[choice].q);
+                        history.push_back(query(state, ml[choice]));
                 }
 
                 return choice;
@@ -218,12 +243,7 @@ struct TD {
                 return mse / n;
         }
 
-        double target(const S &s) const {
-                if (s.winner() == NONE)  return  0.0;
-                if (s.winner() == BLACK) return  1.0;
-                if (s.winner() == WHITE) return  0.0;
-                DIE("not reached");
-        }
+        double target(const S &s) const { return result_target(s.winner()); }
 
         void train(size_t iter, const S &s) {
                 //if (target(s) == 0) return;
@@ -243,6 +263,24 @@ struct TD {
                 //net.save("yavalath.nn");
         }
 
+        // trains the net on the positions of recorded games rather than
+        // online, towards each game's result; returns the mean squared
+        // error per position
+        double train_records(const RecordReader<M> &reader, size_t epochs,
+                             size_t batch_size=256, size_t shuffle=1<<16) {
+                PositionStream<S, SIZE> stream(reader, batch_size, shuffle);
+                stream.start(epochs);
+                double sse = 0;
+                size_t n = 0;
+                net.momentum = momentum;
+                while (const typename PositionStream<S, SIZE>::Minibatch *b = stream.next()) {
+                        sse += net.train_loop(b->input, b->target, 0, learning_rate, 1);
+                        n += b->size;
+                        stream.release();
+                }
+                return n ? sse / n : 0;
+        }
+
         void play_game(S &s) {
                 while (!s.game_over())
                         next(s.current(), s);
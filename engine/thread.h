@@ -7,8 +7,10 @@
 #include <libkern/OSAtomic.h>
 #endif
 
+#include <pthread.h>
 #include <queue>
 
+static const size_t NUM_THREADS = 8;
 
 struct Mutex {
         volatile int exclusion;
@@ -24,9 +26,13 @@ struct Lock {
         ~Lock() { mutex.unlock(); }
 };
 
+#ifdef SYNC_LOG
 static Mutex LOG_MUTEX;
 
 #define SLOG(x) { Lock _l(LOG_MUTEX); LOG(x); }
+#else
+#define SLOG(x) LOG(x) // whole lines from any thread, see log.h
+#endif
 
 template <typename A, typename B=int>
 struct TaskPool {
@@ -84,4 +90,139 @@ struct TaskPool {
         }
 };
 
+
+//-----------------------------------------------------------------------------
+//
+// ThreadPool
+//
+// Worker threads that are started once and then wait for work, for jobs
+// issued too often to pay for a thread per task as TaskPool does. run()
+// calls job(i) for every i in [0,n) on the workers and the calling thread,
+// and returns when all calls are done. A run() issued while the pool is
+// busy (e.g. from inside a job) runs serially on the caller.
+//
+//-----------------------------------------------------------------------------
+
+struct ThreadPool {
+        struct Job {
+                virtual ~Job() {}
+                virtual void operator() (size_t i) = 0;
+        };
+
+        pthread_mutex_t mutex, busy;
+        pthread_cond_t start, done;
+        vector<pthread_t> threads;
+        Mutex claim;
+        Job *job;
+        size_t next, count;
+        volatile size_t pending;
+        unsigned generation;
+        bool stop;
+
+        ThreadPool(size_t workers) : job(0), next(0), count(0), pending(0), generation(0), stop(false) {
+                pthread_mutex_init(&mutex, NULL);
+                pthread_mutex_init(&busy, NULL);
+                pthread_cond_init(&start, NULL);
+                pthread_cond_init(&done, NULL);
+                threads.resize(workers);
+                for (size_t i=0; i < workers; ++i)
+                        pthread_create(&threads[i], NULL, spawn_worker, (void*) this);
+        }
+
+        ~ThreadPool() {
+                pthread_mutex_lock(&mutex);
+                stop = true;
+                pthread_cond_broadcast(&start);
+                pthread_mutex_unlock(&mutex);
+                for (size_t i=0; i < threads.size(); ++i)
+                        pthread_join(threads[i], NULL);
+                pthread_cond_destroy(&done);
+                pthread_cond_destroy(&start);
+                pthread_mutex_destroy(&busy);
+                pthread_mutex_destroy(&mutex);
+        }
+
+        size_t size() const { return threads.size() + 1; }
+
+        // claims indices of generation gen until none are left
+        void work(unsigned gen) {
+                while (true) {
+                        size_t i;
+                        { Lock lock(claim);
+                                if (gen != generation || next >= count)
+                                        return;
+                                i = next++;
+                        }
+
+                        (*job)(i);
+
+                        if (__sync_sub_and_fetch(&pending, 1) == 0) {
+                                pthread_mutex_lock(&mutex);
+                                pthread_cond_signal(&done);
+                                pthread_mutex_unlock(&mutex);
+                        }
+                }
+        }
+
+        void worker() {
+                unsigned seen = 0;
+                pthread_mutex_lock(&mutex);
+                while (true) {
+                        while (!stop && generation == seen)
+                                pthread_cond_wait(&start, &mutex);
+                        if (stop)
+                                break;
+                        seen = generation;
+                        pthread_mutex_unlock(&mutex);
+                        work(seen);
+                        pthread_mutex_lock(&mutex);
+                }
+                pthread_mutex_unlock(&mutex);
+        }
+
+        static void *spawn_worker(void *self) {
+                ((ThreadPool *) self)->worker();
+                return NULL;
+        }
+
+        void run(Job &j, size_t n) {
+                if (n == 0)
+                        return;
+
+                if (threads.empty() || pthread_mutex_trylock(&busy) != 0) {
+                        for (size_t i=0; i < n; ++i)
+                                j(i);
+                        return;
+                }
+
+                unsigned gen;
+                pthread_mutex_lock(&mutex);
+                { Lock lock(claim);
+                        job = &j;
+                        next = 0;
+                        count = n;
+                        pending = n;
+                        gen = ++generation;
+                }
+                pthread_cond_broadcast(&start);
+                pthread_mutex_unlock(&mutex);
+
+                work(gen);
+
+                pthread_mutex_lock(&mutex);
+                while (pending != 0)
+                        pthread_cond_wait(&done, &mutex);
+                job = 0;
+                pthread_mutex_unlock(&mutex);
+                pthread_mutex_unlock(&busy);
+        }
+};
+
+// shared by everything that needs a persistent pool; the caller of run()
+// is the last of the NUM_THREADS threads
+static inline ThreadPool& thread_pool() {
+        static ThreadPool pool(NUM_THREADS-1);
+        return pool;
+}
+
 #endif // THREAD_H
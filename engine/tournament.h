@@ -0,0 +1,195 @@
+#ifndef TOURNAMENT_H
+#define TOURNAMENT_H
+#pragma once
+
+#include "common.h"
+#include "thread.h"
+
+#include <unistd.h>
+
+//-----------------------------------------------------------------------------
+//
+// MatchScore
+//
+// Results of a match from the point of view of one side, with the Elo
+// difference they imply and the log-likelihood ratio used by Tournament.
+// Scores are 1 for a win, 1/2 for a draw; the statistics are the normal
+// approximations over game scores, so draws need no model of their own.
+//
+//-----------------------------------------------------------------------------
+
+struct MatchScore {
+        size_t wins, draws, losses;
+
+        MatchScore() : wins(0), draws(0), losses(0) {}
+
+        size_t games() const { return wins + draws + losses; }
+
+        double score() const {
+                return games() ? (wins + draws/2.0) / games() : 0.5;
+        }
+
+        // of one game's score
+        double variance() const {
+                double p = score();
+                return games() ? (wins*(1-p)*(1-p) + draws*(0.5-p)*(0.5-p) + losses*p*p) / games() : 0;
+        }
+
+        // a score of 0 or 1 is -inf or +inf: no finite difference explains it
+        static double score_to_elo(double s) {
+                s = std::min(std::max(s, 0.0), 1.0);
+                return -400 * log10(1/s - 1);
+        }
+
+        static double elo_to_score(double elo) {
+                return 1 / (1 + pow(10, -elo/400));
+        }
+
+        double elo() const { return score_to_elo(score()); }
+
+        // with one extra win and loss, as a prior that keeps the variance of
+        // a one-sided result (e.g. 9-0-0) from being 0
+        MatchScore corrected() const {
+                MatchScore m = *this;
+                m.wins++;
+                m.losses++;
+                return m;
+        }
+
+        // 95% confidence interval, from the corrected score; an end the
+        // games cannot bound (score interval past 0 or 1) is -inf or +inf
+        void elo_interval(double &low, double &high) const {
+                MatchScore m = corrected();
+                double se = sqrt(m.variance() / m.games());
+                low = score_to_elo(m.score() - 1.96*se);
+                high = score_to_elo(m.score() + 1.96*se);
+        }
+
+        // log-likelihood ratio of "Elo difference is elo1" against "is
+        // elo0"; from the corrected score, so a one-sided start still moves it
+        double llr(double elo0, double elo1) const {
+                MatchScore m = corrected();
+                double s0 = elo_to_score(elo0),
+                       s1 = elo_to_score(elo1);
+                return m.games() * (s1 - s0) * (2*m.score() - s0 - s1) / (2*m.variance());
+        }
+};
+
+//-----------------------------------------------------------------------------
+//
+// Tournament
+//
+// Plays games of G between two settings of the players' parameter (see
+// Game::set_param), A and B, alternating colours, on several worker threads
+// at once. After every game a sequential probability ratio test weighs "A
+// is elo_margin stronger" against "B is elo_margin stronger", with error
+// rates alpha and beta, and the match stops as soon as one is accepted or
+// after max_games. Games already running when it stops are still counted.
+//
+// Each game is a new G, so players must not share state between instances:
+// UCT keeps its nodes per player, but a State with static scratch data
+// (e.g. druid's path finder) needs workers=1. Engines run their own threads,
+// so by default one worker is started per engine_threads cores.
+//
+//-----------------------------------------------------------------------------
+
+template <typename G>
+struct Tournament {
+        enum Decision { UNDECIDED, A_BETTER, B_BETTER };
+
+        float a, b;
+        size_t max_games, workers;
+        double elo_margin, alpha, beta;
+        bool verbose;
+
+        MatchScore result; // of A
+        Decision decision;
+        Mutex mutex;
+        volatile size_t next_game;
+        volatile int stopped;
+
+        Tournament(float pa, float pb, size_t max=1000, size_t engine_threads=NUM_THREADS)
+                : a(pa), b(pb), max_games(max),
+                  workers(default_workers(engine_threads)),
+                  elo_margin(20), alpha(0.05), beta(0.05), verbose(false),
+                  decision(UNDECIDED), next_game(0), stopped(0)
+        {}
+
+        static size_t default_workers(size_t engine_threads) {
+                long cores = sysconf(_SC_NPROCESSORS_ONLN);
+                if (cores <= 0 || engine_threads == 0)
+                        return 1;
+                return std::max<size_t>(cores / engine_threads, 1);
+        }
+
+        double lower() const { return log(beta / (1 - alpha)); }
+        double upper() const { return log((1 - beta) / alpha); }
+        double llr() const { return result.llr(-elo_margin, elo_margin); }
+
+        // A plays black in even games
+        void play(size_t i) {
+                bool a_black = (i % 2) == 0;
+                G game;
+                game.set_param(BLACK, a_black ? a : b);
+                game.set_param(WHITE, a_black ? b : a);
+                Color winner = game.play(false);
+                Color a_color = a_black ? BLACK : WHITE;
+
+                Lock lock(mutex);
+                if (winner == a_color) result.wins++;
+                else if (winner == other(a_color)) result.losses++;
+                else result.draws++;
+
+                double r = llr();
+                if (decision == UNDECIDED) {
+                        if (r >= upper()) decision = A_BETTER;
+                        else if (r <= lower()) decision = B_BETTER;
+                        if (decision != UNDECIDED)
+                                stopped = 1;
+                }
+                if (verbose)
+                        SLOG("game " << i << ": " << result.wins << '-' << result.draws
+                             << '-' << result.losses << " llr=" << r);
+        }
+
+        void work() {
+                while (!stopped) {
+                        size_t i = __sync_fetch_and_add(&next_game, 1);
+                        if (i >= max_games)
+                                return;
+                        play(i);
+                }
+        }
+
+        static void *spawn_thread(void *self) {
+                ((Tournament *) self)->work();
+                return NULL;
+        }
+
+        Decision run() {
+                size_t n = std::max<size_t>(std::min(workers, max_games), 1);
+                vector<pthread_t> threads(n);
+                for (size_t i=0; i < n; ++i)
+                        pthread_create(&threads[i], NULL, spawn_thread, this);
+                for (size_t i=0; i < n; ++i)
+                        pthread_join(threads[i], NULL);
+                return decision;
+        }
+
+        void report() const {
+                double low, high;
+                result.elo_interval(low, high);
+                static const char *decisions[] = { "undecided", "A better", "B better" };
+                LOG("A=" << a << " B=" << b << ": "
+                    << result.wins << '-' << result.draws << '-' << result.losses
+                    << " elo(A-B)=" << result.elo() << " [" << low << ", " << high << "]"
+                    << " llr=" << llr() << " (" << lower() << ", " << upper() << ") "
+                    << decisions[decision]);
+        }
+
+private:
+        Tournament(const Tournament &);
+        Tournament& operator=(const Tournament &);
+};
+
+#endif // TOURNAMENT_H
@@ -5,14 +5,13 @@
 #include "common.h"
 #include "thread.h"
 #include "memory.h"
-
-static const size_t NUM_THREADS = 8;
+#include "stats.h"
+#include "ponder.h"
 
 #pragma pack(1)
 template <typename S, size_t MAX_MOVES>
 struct UCTNode {
         typedef typename S::ML ML;
-        static MemoryPool<UCTNode> pool;
 
         S state;
         uint32_t move, untried;
@@ -33,6 +32,7 @@ struct UCTNode {
                 parent = p;
                 state.copy_from(state);
                 state.moves(moves);
+                STATS_INC(movegen);
                 untried = moves.size();
         }
 
@@ -92,7 +92,7 @@ struct UCTNode {
                 return -1;
         }
 
-        UCTNode *add(size_t m, S &state) {
+        UCTNode *add(size_t m, S &state, MemoryPool<UCTNode> &pool) {
                 UCTNode *n = pool.alloc();
                 n->init(state, m, this);
                 tried[m] = true;
@@ -131,15 +131,44 @@ struct UCT {
 
         typedef UCTNode<S,MAX_MOVES> Node;
 
-        UCT() : Cp(sqrt(2)) {}
+        // nodes of the current search; one per player, so players (and
+        // games) can search at the same time
+        MemoryPool<Node> pool;
+
+        // visit counts of the root's children after each search, for game
+        // records (see record.h); kept only when record_visits is set
+        bool record_visits;
+        vector<std::pair<typename S::M, uint32_t> > root_visits;
+
+#ifdef STATS
+        SearchStats stats; // of the last move
+#endif
+
+        // pondering (see ponder.h): the tree of the position after our move,
+        // grown for up to ponder_iter iterations in the same pool; next()
+        // searches on from the subtree under the opponent's reply
+        Ponder ponder;
+        bool ponder_on;
+        size_t ponder_iter;
+        Node ponder_root;
+        S ponder_state;
+
+        UCT() : Cp(sqrt(2)), pool(MAX_ITER+1), record_visits(false),
+                ponder_on(false), ponder_iter(0) {}
+
+        ~UCT() { ponder.stop(); }
 
         Node* select(S &state, Node *node) {
                 DEBUG("SELECT");
+                STATS_ONLY(uint64_t d = 0;)
                 while (node && node->untried == 0 && node->child != 0) {
                         node = node->select(Cp);
                         if (node)
                                 node->make_move(state);
+                        STATS_ONLY(d++;)
                 }
+                STATS_ADD(depth, d);
+                STATS_MAX(max_depth, d);
                 return node;
         }
 
@@ -147,8 +176,9 @@ struct UCT {
                 DEBUG("EXPAND");
                 if (node->untried > 0) {
                         uint32_t m = node->expand();
+                        STATS_INC(expanded);
                         state.move(node->moves[m]);
-                        node = node->add(m, state);
+                        node = node->add(m, state, pool);
                 }
                 return node;
         }
@@ -158,8 +188,10 @@ struct UCT {
                 ML ml;
                 typename S::M m;
                 while (!state.game_over()) {
-                        if (state.random_move(ml, m))
+                        if (state.random_move(ml, m)) {
                                 state.move(m);
+                                STATS_INC(rollout_moves);
+                        }
                 }
         }
 
@@ -179,15 +211,23 @@ struct UCT {
                 S child;
                 child.copy_from(state);
 
+                STATS_INC(playouts);
                 { Lock lock(mutex);
-                        node = select(child, node);
+                        { STATS_TIME(select);
+                                node = select(child, node);
+                        }
                         if (!node) return;
-                        node = expand(child, node);
+                        { STATS_TIME(expand);
+                                node = expand(child, node);
+                        }
                 }
 
-                rollout(child);
+                { STATS_TIME(rollout);
+                        rollout(child);
+                }
 
                 { Lock lock(mutex);
+                        STATS_TIME(backprop);
                         backprop(child, node);
                 }
         }
@@ -200,7 +240,10 @@ struct UCT {
                 assert(result);
                 uint32_t best=result->visits;
 
+                root_visits.clear();
                 for (Node *n=root->child; n != NULL; n=n->next) {
+                        if (record_visits)
+                                root_visits.push_back(std::make_pair(n->get_move(), n->visits));
                         //LOG("{ " << n->visits << ' ' << ((float) n->visits / (float) MAX_ITER) << " " << state.move_str(n->get_move()) << " }");
                         if (n->visits > best) {
                                 best = n->visits;
@@ -221,34 +264,106 @@ struct UCT {
                 size_t iter;
                 Node *root;
                 S *state;
+                const Ponder *ponder; // stops early, and is not counted
 
                 void operator () (int dummy) {
-                        for (size_t i=0; i < iter; ++i)
+                        for (size_t i=0; i < iter; ++i) {
+                                if (ponder && ponder->stopped())
+                                        return;
                                 uct->iterate(root, *state);
+                        }
+                        if (!ponder)
+                                STATS_GATHER(uct->stats, uct->mutex);
                 }
         };
 
 
         void next(Color c, S &state) {
-                Node::pool.clear();
-                Node root;
-                root.init(state, 0, 0);
+                Node fresh, *root = ponder_reuse(state);
+                STATS_ONLY(stats.clear();)
+                if (!root) {
+                        pool.clear();
+                        fresh.init(state, 0, 0);
+                        root = &fresh;
+                }
 
                 TaskPool<Task> tasks(NUM_THREADS);
 
                 Task task;
                 task.uct = this;
-                task.root = &root;
+                task.root = root;
                 task.iter = MAX_ITER / NUM_THREADS;
                 task.state = &state;
+                task.ponder = 0;
+
+                for (size_t i=0; i < NUM_THREADS; ++i)
+                        tasks.push(task);
+
+                tasks.run();
+
+                STATS_GATHER(stats, mutex); // the root's
+                STATS_ONLY(stats.pool_used = pool.counter;)
+                STATS_ONLY(stats.pool_size = pool.size;)
+                STATS_END_MOVE(stats, "uct");
+
+                move(root, state);
+
+                if (ponder_on && !state.game_over())
+                        ponder_start(state);
+        }
+
+        // searches the opponent's turn, for up to iter iterations; the node
+        // pool grows by as many nodes
+        void set_ponder(bool on, size_t iter=MAX_ITER) {
+                ponder.stop();
+                ponder_on = on;
+                ponder_iter = on ? iter : 0;
+                pool.resize(MAX_ITER + ponder_iter + 1);
+        }
+
+        void ponder_start(S &state) {
+                pool.clear();
+                ponder_state.copy_from(state);
+                ponder_root.init(ponder_state, 0, 0);
+                ponder.start(this);
+        }
+
+        void ponder_search() {
+                TaskPool<Task> tasks(NUM_THREADS);
+
+                Task task;
+                task.uct = this;
+                task.root = &ponder_root;
+                task.iter = ponder_iter / NUM_THREADS;
+                task.state = &ponder_state;
+                task.ponder = &ponder;
 
                 for (size_t i=0; i < NUM_THREADS; ++i)
                         tasks.push(task);
 
                 tasks.run();
+        }
 
-                move(&root, state);
+        // stops pondering; the subtree under the move that led to state, as
+        // a root, or NULL if it was not searched
+        Node *ponder_reuse(S &state) {
+                if (!ponder.running)
+                        return NULL;
+                ponder.stop();
+                for (Node *n=ponder_root.child; n != NULL; n=n->next) {
+                        S s;
+                        s.copy_from(ponder_state);
+                        n->make_move(s);
+                        if (same_position(s, state)) {
+                                DEBUG("ponder: reusing " << n->visits << " visits");
+                                n->parent = 0;
+                                n->next = 0;
+                                return n;
+                        }
+                }
+                return NULL;
         }
+
         void set_param(float p) { Cp = p; }
         void pretrain(size_t i) {}
 };
@@ -0,0 +1,107 @@
+#ifndef HEADLESS
+#define HEADLESS
+#endif
+
+// the engines announce every move through LOG, which would mix with the
+// CSV and JSON on stdout
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_NONE
+#endif
+
+// before the headers that leave #pragma pack(1) set
+#include <fstream>
+#include "batch.h"
+
+#include "uct.h"
+#include "game.h"
+#include "random.h"
+#include "montecarlo.h"
+#include "connect4.h"
+#include "connect6.h"
+#include "tanbo.h"
+#include "ttt.h"
+
+//----------------------------------------------------------------------------
+//
+// Headless batch driver: plays games of one of the pairs below at full speed
+// and reports throughput and win rates, optionally as CSV (one row per game)
+// and JSON (summary)
+//
+//      batch [game] [games] [workers] [csv file] [json file]
+//
+// game is connect4, connect6, tanbo or ttt; "-" for a file is stdout, and
+// the summary then goes to stderr.
+//
+//----------------------------------------------------------------------------
+
+static const size_t MAX_ITER = 2000;
+
+typedef connect4::State<7,6> Connect4State;
+typedef Game<   Connect4State,
+                UCT<Connect4State, MAX_ITER, 7>,
+                Random<Connect4State> > Connect4Game;
+
+static const size_t C6_SIZE  = 19,
+                    C6_MOVES = binomial_coeff<C6_SIZE*C6_SIZE,2>::result;
+typedef connect6::State<C6_SIZE,C6_MOVES> Connect6State;
+typedef Game<   Connect6State,
+                MonteCarlo<Connect6State, C6_MOVES, 100>,
+                Random<Connect6State> > Connect6Game;
+
+typedef tanbo::State<9,9*9> TanboState;
+typedef Game<   TanboState,
+                UCT<TanboState, MAX_ITER, 9*9>,
+                Random<TanboState> > TanboGame;
+
+typedef ttt::State<3> TTTState;
+typedef Game<   TTTState,
+                UCT<TTTState, MAX_ITER, TTTState::Board::AREA>,
+                Random<TTTState> > TTTGame;
+
+static bool is_stdout(const char *path) {
+        return path && string(path) == "-";
+}
+
+static void write(const char *path, const string &s) {
+        if (!path)
+                return;
+        if (is_stdout(path)) {
+                cout << s << flush;
+                return;
+        }
+        ofstream f(path);
+        if (!f)
+                DIE("cannot write " << path);
+        f << s;
+}
+
+template <typename G>
+int run(const char *name, size_t games, size_t workers, const char *csv, const char *json) {
+        Batch<G> batch(games, workers);
+        batch.run();
+        batch.report(is_stdout(csv) || is_stdout(json) ? cerr : cout, name);
+
+        stringstream c, j;
+        batch.write_csv(c);
+        batch.write_json(j, name);
+        write(csv, c.str());
+        write(json, j.str());
+        return 0;
+}
+
+int main(int argc, char **argv) {
+        string game       = (argc > 1) ? argv[1] : "connect4";
+        size_t games      = (argc > 2) ? atoi(argv[2]) : 100,
+               workers    = (argc > 3) ? atoi(argv[3]) : 1;
+        const char *csv   = (argc > 4) ? argv[4] : 0,
+                   *json  = (argc > 5) ? argv[5] : 0;
+
+        srandom(time(NULL));
+
+        if (game == "connect4") return run<Connect4Game>("connect4", games, workers, csv, json);
+        if (game == "connect6") return run<Connect6Game>("connect6", games, workers, csv, json);
+        if (game == "tanbo")    return run<TanboGame>("tanbo", games, workers, csv, json);
+        if (game == "ttt")      return run<TTTGame>("ttt", games, workers, csv, json);
+
+        DIE("unknown game " << game << " (connect4, connect6, tanbo, ttt)");
+}
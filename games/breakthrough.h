@@ -11,9 +11,9 @@
 #define BT_STATE_H
 
 #include "common.h"
+#include "bitboard.h"
 #include "game.h"
 
-#include <vector>
 #include <stack>
 #include <iostream>
 #include <sstream>
@@ -41,8 +41,31 @@ struct BTStateID
 typedef BTBoard BTKey;
 typedef BTBoard BTMove;
 const BTMove NullMove = 0;
-typedef std::vector<BTMove> BTMoves;
-typedef std::vector<BTStateID> History;
+
+const BTBoard BT_FILE_A = 0x0101010101010101ULL;
+const BTBoard BT_FILE_H = 0x8080808080808080ULL;
+
+// at most 16 pawns with three moves each
+const size_t BT_MAX_MOVES = 48;
+
+struct BTMoves
+{
+        BTMove move[BT_MAX_MOVES];
+        uint8_t count;
+
+        BTMoves() : count(0) {}
+
+        size_t size() const { return count; }
+        void clear() { count = 0; }
+
+        void push_back(const BTMove &m) {
+                assert(count < BT_MAX_MOVES);
+                move[count++] = m;
+        }
+
+        BTMove& operator[](size_t i) { return move[i]; }
+        const BTMove& operator[](size_t i) const { return move[i]; }
+};
 
 typedef unsigned short BTScore;
 const BTScore BT_NOT_OVER	= 0x00;  // 00
@@ -60,9 +83,8 @@ public:
 	BTBoard blackboard;
 private:
 	BTPiece turn;
-	History history;
-	void getLineMovesWhite(BTMoves& moves, BTMove& from);
-	void getLineMovesBlack(BTMoves& moves, BTMove& from);
+	void getTargets(BTBoard to[3]) const;
+	BTBoard getOrigin(const BTBoard& to, int dir) const;
 public:
 	BTState();
 	~BTState();
@@ -84,6 +106,7 @@ public:
 	
         void moves(ML &ml) { getMoves(ml); }
 	void getMoves(BTMoves& moves);
+	bool getRandomMove(BTMove& move);
 	bool isPieceAt(BTBoard& board, BTPos& pos);
 	void make(const BTMove& move);  // Returns true if a piece was captured;
         void move(M &m) { make(m); }
@@ -99,13 +122,7 @@ public:
 	std::string toString();
 
         int score(bool b) { return 0; }
-        bool random_move(ML &ml, M&m) {
-                moves(ml);
-                if (!ml.size()) 
-                        return false;
-                m = ml[random() % ml.size()];
-                return true;
-        }
+        bool random_move(ML &ml, M&m) { return getRandomMove(m); }
 
         float result(Color c) {
                 BTScore s = isTerminal();
@@ -281,6 +298,288 @@ public:
 	}
 };
 
+
+//-----------------------------------------------------------------------------
+//
+// BTState
+//
+//-----------------------------------------------------------------------------
+
+inline BTState::BTState()
+{
+	reset();
+}
+inline BTState::~BTState()
+{
+}
+
+inline BTPiece BTState::getSquare(const BTPos& col, const BTPos& row)
+{
+	if(col > 7 || col < 0)
+		return BT_EMPTY_CELL;
+	if(row > 7 || row < 0)
+		return BT_EMPTY_CELL;
+	
+	BTBoard mask = static_cast<BTBoard>(1) << (row*8+col);
+	if(whiteboard & mask)
+		return BT_WHITE_PAWN;
+	if(blackboard & mask)
+		return BT_BLACK_PAWN;
+	return BT_EMPTY_CELL;
+}
+
+inline void BTState::setSquare(const BTPos& col, const BTPos& row, const BTPiece& piece)
+{
+	BTBoard mask = static_cast<BTBoard>(1) << (row*8+col);
+	if(!piece)
+	{
+		mask = ~mask;
+		whiteboard = whiteboard & mask;
+		blackboard = blackboard & mask;
+		return;
+	}
+	if(piece == BT_WHITE_PAWN)
+	{
+		whiteboard = whiteboard | mask;
+		blackboard = blackboard & (~mask);
+		return;
+	}
+	blackboard = blackboard | mask;
+	whiteboard = whiteboard & (~mask);
+}
+inline void BTState::clear()
+{
+        reset();
+}
+inline void BTState::reset()
+{
+	whiteboard = 0x000000000000FFFFULL;
+	blackboard = 0xFFFF000000000000ULL;
+	
+	turn = BT_WHITE_PAWN;
+	
+	BTStateID sid;
+	sid.white = whiteboard;
+	sid.black = blackboard;
+}
+
+inline BTStateID BTState::getID()
+{
+	BTStateID id;
+	id.white = whiteboard;
+	id.black = blackboard;
+	id.turn = turn;
+	return id;
+}
+
+// Destination squares of the side to move for the three move directions,
+// computed with whole-board shifts: 0 = diagonal towards the a-file,
+// 1 = straight ahead (must be empty), 2 = diagonal towards the h-file.
+inline void BTState::getTargets(BTBoard to[3]) const
+{
+	BTBoard empty = ~(whiteboard|blackboard);
+	if(turn == BT_WHITE_PAWN)
+	{
+		to[0] = ((whiteboard & ~BT_FILE_A) << 7) & ~whiteboard;
+		to[1] = (whiteboard << 8) & empty;
+		to[2] = ((whiteboard & ~BT_FILE_H) << 9) & ~whiteboard;
+	}
+	else
+	{
+		to[0] = ((blackboard & ~BT_FILE_A) >> 9) & ~blackboard;
+		to[1] = (blackboard >> 8) & empty;
+		to[2] = ((blackboard & ~BT_FILE_H) >> 7) & ~blackboard;
+	}
+}
+
+inline BTBoard BTState::getOrigin(const BTBoard& to, int dir) const
+{
+	if(turn == BT_WHITE_PAWN)
+		return to >> (7+dir);
+	return to << (9-dir);
+}
+
+inline void BTState::getMoves(BTMoves& moves)
+{
+	BTBoard to[3];
+	getTargets(to);
+	for(int d = 0 ; d < 3 ; d++)
+	{
+		BTBoard n = to[d];
+		while(n)
+		{
+			BTBoard j = n & (~n+1);
+			moves.push_back(getOrigin(j, d) | j);
+			n ^= j;
+		}
+	}
+}
+
+// Pick a uniformly random legal move by selecting a random set bit of the
+// target masks, without building the move list.
+inline bool BTState::getRandomMove(BTMove& move)
+{
+	BTBoard to[3];
+	getTargets(to);
+	int count[3] = { popcount(to[0]), popcount(to[1]), popcount(to[2]) };
+	int total = count[0] + count[1] + count[2];
+	if(!total)
+		return false;
+
+	int k = random() % total;
+	int d = 0;
+	while(k >= count[d])
+		k -= count[d++];
+
+	BTBoard n = to[d];
+	while(k--)
+		n &= n-1; // reset LS1B
+	BTBoard j = n & (~n+1);
+	move = getOrigin(j, d) | j;
+	return true;
+}
+
+inline void BTState::make(const BTMove& move)
+{
+	if(move == NullMove)
+	{	
+		turn = turn == BT_BLACK_PAWN ? BT_WHITE_PAWN : BT_BLACK_PAWN;
+		return;
+	}
+	
+	if(turn == BT_WHITE_PAWN)
+	{
+		whiteboard ^= move;
+		if(blackboard & move)
+			blackboard &= (~move);
+		turn = BT_BLACK_PAWN;
+	}
+	else
+	{
+		blackboard ^= move;
+		if(whiteboard & move)
+			whiteboard &= (~move);
+		turn = BT_WHITE_PAWN;
+	}
+}
+
+inline void BTState::retract(const BTStateID& id)
+{
+	syncState(id);
+}
+
+inline void BTState::syncState(const BTStateID& id)
+{
+	whiteboard = id.white;
+	blackboard = id.black;
+	turn = id.turn;
+}
+
+
+inline BTScore BTState::isTerminal()
+{
+	if(!whiteboard)
+		return BT_BLACK_WINS;
+	if(!blackboard)
+		return BT_WHITE_WINS;
+	if(whiteboard & 0xFF00000000000000ULL)
+		return BT_WHITE_WINS;
+	if(blackboard & 0x00000000000000FFULL)
+		return BT_BLACK_WINS;
+	
+	return BT_NOT_OVER;
+}
+
+inline bool BTState::isCapture(const BTMove& move)
+{
+	if(turn == BT_WHITE_PAWN)
+		return (whiteboard^move)&blackboard;
+	else
+		return (blackboard^move)&whiteboard;
+}
+
+inline bool BTState::strToMove(std::string strMove, BTMove& move)
+{
+	if(strMove.length() < 4)
+		return false;
+	BTPos fromCol = strMove[0] - BT_CHAR_OFFSET;
+	if(fromCol < 0 || fromCol > 7)
+		return false;
+	BTPos fromRow = strMove[1] - '1';
+	if(fromRow < 0 || fromRow > 7)
+		return false;
+	BTPos toCol = strMove[2] - BT_CHAR_OFFSET;
+	if(toCol < 0 || toCol > 7)
+		return false;
+	BTPos toRow = strMove[3] - '1';
+	if(toRow < 0 || toRow > 7)
+		return false;
+	if(fromRow == toRow)
+		return false;
+	if(fromRow < toRow && turn != BT_WHITE_PAWN)
+		return false;
+	if(fromRow > toRow && turn != BT_BLACK_PAWN)
+		return false;
+	if(fromCol - toCol > 1 || toCol - fromCol > 1)
+		return false;
+	
+	BTMove mask = 1;
+	move = (mask << (fromCol+fromRow*8)) | (mask << (toCol+toRow*8));
+	
+	return true;
+}
+inline bool BTState::setPosition(std::string pos)
+{
+	if(pos.length() < 65)
+		return false;
+	// First validate
+	for(int n = 0 ; n < 64 ; n++)
+	{
+		if(pos[n] != 'w' && pos[n] != 'b' && pos[n] != '.')
+			return false;
+	}
+	if(pos[64] != 'W' && pos[64] != 'B' ) 
+		return false;
+	for(int n = 0 ; n < 64 ; n++)
+	{
+		if(pos[n] == 'w')
+			setSquare(n%8, n/8, BT_WHITE_PAWN);
+		else if(pos[n] == 'b')
+			setSquare(n%8, n/8, BT_BLACK_PAWN);
+		else
+			setSquare(n%8, n/8, BT_EMPTY_CELL);
+	}
+	turn = BT_WHITE_PAWN;
+	if(pos[64] == 'B' ) 
+		turn = BT_BLACK_PAWN;
+	
+	return true;
+}
+
+inline std::string BTState::toString()
+{
+	BTPiece piece;
+	std::stringstream ss;
+	ss << "     a b c d e f g h" << std::endl << std::endl;
+	for(BTPos n = 7 ; n >= 0 ; n--)
+	{
+		ss << (n+1) << "    ";
+		for(BTPos m = 0 ; m < 8 ; m++)
+		{
+			piece = getSquare(m, n);
+			if(piece == BT_WHITE_PAWN)
+				ss << "w ";
+			else if(piece == BT_BLACK_PAWN)
+				ss << "b ";
+			else
+				ss << ". ";
+		}
+		ss << "   " << (n+1) << std::endl;
+	}
+	ss << std::endl <<"     a b c d e f g h" << std::endl;
+	return ss.str();
+}
+
 } // namespace breakthrough
 
 #endif // BT_STATE_H
@@ -62,14 +62,6 @@ typedef Game<   congo::State,
                 PLAYER_Y > CongoGame;
 
 
-//----------------------------------------------------------------------------
-//
-// Static symbols
-//
-//----------------------------------------------------------------------------
-
-template<> MemoryPool<CongoUCT::Node> CongoUCT::Node::pool(GAME_SIZE+1);
-
 
 //----------------------------------------------------------------------------
 //
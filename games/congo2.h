@@ -617,6 +617,52 @@ struct State {
                 _just_played = WHITE;
         }
 
+        // Set up a position from a FEN-like string: the seven ranks from
+        // the top of str() down, separated by '/', with PIECE_LABEL letters
+        // (upper case is black) and digits for runs of empty squares,
+        // followed by the side to move, e.g.
+        //
+        //   "GMELECZ/PPPPPPP/7/7/7/ppppppp/gmelecz b"
+        //
+        bool parse_position(const string &fen) {
+                clear();
+                int x=0, y=0;
+                size_t i=0;
+                for (; i < fen.size() && fen[i] != ' '; ++i) {
+                        char ch = fen[i];
+                        if (ch == '/') {
+                                if (x != 7) return false;
+                                x = 0, ++y;
+                                continue;
+                        }
+                        if (ch >= '1' && ch <= '7') {
+                                x += ch - '0';
+                                if (x > 7) return false;
+                                continue;
+                        }
+                        const char *p = strchr(PIECE_LABEL+1, tolower(ch));
+                        if (!p || x >= 7 || y >= 7)
+                                return false;
+                        place(isupper(ch) ? BLACK : WHITE, (Piece) (p-PIECE_LABEL), x+(y<<3));
+                        ++x;
+                }
+                if (x != 7 || y != 6)
+                        return false;
+
+                while (i < fen.size() && fen[i] == ' ')
+                        ++i;
+                if (i >= fen.size())
+                        return false;
+                switch (fen[i]) {
+                case 'b': _just_played = WHITE; break;
+                case 'w': _just_played = BLACK; break;
+                default: return false;
+                }
+                _winner = NONE;
+                copy_river();
+                return true;
+        }
+
 
         char label(Color c, Piece p) const {
                 if (c == BLACK)
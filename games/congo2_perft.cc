@@ -0,0 +1,20 @@
+#include "congo2.h"
+#include "congo_perft.h"
+
+//----------------------------------------------------------------------------
+//
+// Perft for the congo2.h move generator
+//
+//      congo2_perft [depth] [threads]
+//
+//----------------------------------------------------------------------------
+
+int main(int argc, char **argv) {
+        size_t depth   = (argc > 1) ? atoi(argv[1]) : 4,
+               threads = (argc > 2) ? atoi(argv[2]) : NUM_THREADS;
+
+        congo::populate();
+        LOG("sizeof(congo::State) = " << sizeof(congo::State)
+            << " sizeof(congo::Move) = " << sizeof(congo::Move));
+        return congo::perft_suite("congo2", depth, threads) ? 0 : 1;
+}
@@ -0,0 +1,20 @@
+#include "congo.h"
+#include "congo_perft.h"
+
+//----------------------------------------------------------------------------
+//
+// Perft for the congo.h move generator
+//
+//      congo_perft [depth] [threads]
+//
+//----------------------------------------------------------------------------
+
+int main(int argc, char **argv) {
+        size_t depth   = (argc > 1) ? atoi(argv[1]) : 4,
+               threads = (argc > 2) ? atoi(argv[2]) : NUM_THREADS;
+
+        congo::populate();
+        LOG("sizeof(congo::State) = " << sizeof(congo::State)
+            << " sizeof(congo::Move) = " << sizeof(congo::Move));
+        return congo::perft_suite("congo", depth, threads) ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+#ifndef CONGO_PERFT_H
+#define CONGO_PERFT_H
+#pragma once
+
+#include "perft.h"
+
+// Shared by congo_perft.cc and congo2_perft.cc. Include after congo.h or
+// congo2.h (both declare namespace congo), so the same positions and
+// expected counts validate both move generators.
+
+namespace congo {
+
+static const size_t PERFT_MAX_DEPTH = 6;
+
+struct PerftPosition {
+        const char *name, *fen;
+        uint64_t expected[PERFT_MAX_DEPTH]; // leaf counts for depth 1..N, 0 if unknown
+};
+
+static const PerftPosition PERFT_POSITIONS[] = {
+        { "initial",
+          "GMELECZ/PPPPPPP/7/7/7/ppppppp/gmelecz b",
+          { 24, 576, 14332, 356416, 9398812, 247600597 } },
+        { "middlegame",
+          "G1ELE1Z/PP1P1PP/2M2C1/2P1p2/1z3m1/pp1p1pp/g1ele1c w",
+          { 32, 1050, 32985, 1067202, 34150086, 1130753263 } },
+        { "lions facing",
+          "3L3/7/7/7/7/7/3l3 b",
+          { 6, 26, 129, 612, 3008, 14452 } },
+        { "promotion",
+          "2L1Z2/P5p/7/3C3/7/p5P/3l2G w",
+          { 11, 305, 3342, 93092, 1031911, 29304881 } },
+};
+
+static const size_t NUM_PERFT_POSITIONS = sizeof(PERFT_POSITIONS) / sizeof(PerftPosition);
+
+// Run every position to max_depth, logging nodes/sec; returns false if any
+// count differs from its expected value.
+static inline bool perft_suite(const char *variant, size_t max_depth, size_t threads) {
+        bool ok = true;
+        uint64_t total_nodes = 0;
+        double total_seconds = 0;
+
+        if (max_depth > PERFT_MAX_DEPTH)
+                max_depth = PERFT_MAX_DEPTH;
+
+        for (size_t p=0; p < NUM_PERFT_POSITIONS; ++p) {
+                const PerftPosition &pos = PERFT_POSITIONS[p];
+                State state;
+                if (!state.parse_position(pos.fen)) {
+                        LOG(variant << ": could not parse '" << pos.fen << "'");
+                        ok = false;
+                        continue;
+                }
+
+                for (size_t d=1; d <= max_depth; ++d) {
+                        Perft<State>::Result r = Perft<State>::run(state, d, threads);
+                        uint64_t expected = pos.expected[d-1];
+                        bool match = (expected == 0 || expected == r.nodes);
+                        ok = ok && match;
+                        total_nodes += r.nodes;
+                        total_seconds += r.seconds;
+
+                        stringstream s;
+                        s << variant << ": " << pos.name << " depth=" << d
+                          << " nodes=" << r.nodes
+                          << " time=" << r.seconds
+                          << " nps=" << (uint64_t) r.nps();
+                        if (!match)
+                                s << " MISMATCH expected=" << expected;
+                        LOG(s.str());
+                }
+        }
+
+        LOG(variant << ": total nodes=" << total_nodes
+            << " time=" << total_seconds
+            << " nps=" << (uint64_t) (total_seconds > 0 ? total_nodes / total_seconds : 0)
+            << (ok ? " ok" : " FAILED"));
+        return ok;
+}
+
+} // namespace congo
+
+#endif // CONGO_PERFT_H
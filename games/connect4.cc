@@ -81,14 +81,6 @@ typedef Game<   Connect4State,
                 PLAYER_X,
                 PLAYER_Y > Connect4Game;
 
-//----------------------------------------------------------------------------
-//
-// Static symbols
-//
-//----------------------------------------------------------------------------
-
-template<> MemoryPool<Connect4UCT::Node> Connect4UCT::Node::pool(MAX_ITER);
-
 
 //----------------------------------------------------------------------------
 //
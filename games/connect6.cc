@@ -78,14 +78,6 @@ typedef Game<   Connect6State,
                 PLAYER_X,
                 PLAYER_Y > Connect6Game;
 
-//----------------------------------------------------------------------------
-//
-// Static symbols
-//
-//----------------------------------------------------------------------------
-
-template<> MemoryPool<Connect6UCT::Node> Connect6UCT::Node::pool(MAX_ITER);
-
 //----------------------------------------------------------------------------
 //
 // MAIN
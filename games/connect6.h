@@ -2,13 +2,14 @@
 #define CONNECT6_H
 #pragma once
 
+#include <engine/bitboard.h>
 #include <engine/board.h>
 #include <engine/memory.h>
 #include <engine/state.h>
 #include <engine/montecarlo.h>
+#ifndef HEADLESS
 #include <ui/board.h>
-
-#include <bitset>
+#endif
 
 
 //----------------------------------------------------------------------------
@@ -58,7 +59,7 @@ struct Move {
 #pragma pack(1)
 template <typename S, size_t SIZE>
 struct MoveList {
-        bitset<SIZE*SIZE> occupied;
+        WideBitboard<SIZE,SIZE> occupied;
         uint16_t count, two_moves:1;
         Move<SIZE> m;
 
@@ -101,17 +102,12 @@ struct MoveList {
                 uint16_t n=0;
 
                 if (!two_moves) {
-                        for (uint16_t i=0; i < (SIZE*SIZE); ++i) {
-                                if (!occupied[i]) {
-                                        if (n == k) {
-                                                m.a = i;
-                                                m.b = 0;
-                                                return;
-                                        }
-                                        ++n;
-                                }
-                        }
-                        DIE("not reached");
+                        size_t i = (~occupied).nth(k);
+                        if (i == SIZE*SIZE)
+                                DIE("not reached");
+                        m.a = i;
+                        m.b = 0;
+                        return;
                 }
 
                 for (uint16_t i=0; i < (SIZE*SIZE); ++i) {
@@ -135,7 +131,9 @@ struct MoveList {
         }
 };
 
-static GBoard WINDOW(600, 600, 19);
+#ifndef HEADLESS
+static AsyncGBoard WINDOW(600, 600, 19);
+#endif
 
 #pragma pack(1)
 template <size_t SIZE, size_t MAX_MOVES>
@@ -147,8 +145,8 @@ struct State : BaseState {
         enum Direction { N, S, E, W, NE, NW, SE, SW };
 
         bool two_moves:1;
-        bitset<SIZE*SIZE> black;
-        bitset<SIZE*SIZE> white;
+        WideBitboard<SIZE,SIZE> black;
+        WideBitboard<SIZE,SIZE> white;
 
         typedef MCMoveCounter<State, MAX_MOVES> MoveCounter;
 
@@ -397,16 +395,23 @@ struct State : BaseState {
         }
 
         void display() {
+#ifndef HEADLESS
                 GBoard::player_t b, w;
                 for (uint16_t i=0; i < Board::AREA; ++i) {
                         if (color(i) == BLACK) b.push_back(i);
                         else if (color(i) == WHITE) w.push_back(i);
                 }
                 WINDOW.update(GBoard::GO, b, w);
+#endif
         }
 
         void print() {
-                display(); return;
+#ifndef HEADLESS
+                if (WINDOW.enabled) {
+                        display();
+                        return;
+                }
+#endif
                 cout << str();
                 cout << flush;
         }
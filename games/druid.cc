@@ -27,6 +27,10 @@
 //#define PLAYER_X DruidUCT
 //#define PLAYER_Y DruidNegascout
 
+// PLAYER_X searches on PLAYER_Y's time, e.g. while the human thinks; a
+// pondering DruidUCT needs twice the nodes
+//#define PONDER
+
 
 //----------------------------------------------------------------------------
 //
@@ -50,7 +54,8 @@ static const size_t SIZE         = 5,
 
 typedef druid::State<
                 SIZE,
-                MAX_MOVES > DruidState;
+                MAX_MOVES,
+                BitSquarePathFinder<SIZE> > DruidState; // or SquarePathFinder<SIZE>
 
 typedef UCT<    DruidState,
                 MAX_ITER,
@@ -87,8 +92,7 @@ typedef Game<   DruidState,
 //
 //----------------------------------------------------------------------------
 
-template<> MemoryPool<DruidUCT::Node> DruidUCT::Node::pool(MAX_ITER);
-template<> SquarePathFinder<SIZE> DruidState::path_finder(0);
+template<> DruidState::PathFinder DruidState::path_finder(0);
 
 
 //----------------------------------------------------------------------------
@@ -101,6 +105,9 @@ void *test2(void *) {
         DruidGame game;
         game.set_param(BLACK, 3.8);
         game.set_param(WHITE, 3.8);
+#ifdef PONDER
+        game.black.set_ponder(true);
+#endif
         game.play();
         return NULL;
 }
@@ -90,12 +90,14 @@ struct MoveList {
 
 #pragma pack(1)
 template <size_t SIZE,
-          size_t MAX_MOVES>
+          size_t MAX_MOVES,
+          typename PF = BitSquarePathFinder<SIZE> >
 struct State {
         typedef MoveList<MAX_MOVES> ML;
         typedef Move M;
+        typedef PF PathFinder;
 
-        static SquarePathFinder<SIZE> path_finder;
+        static PathFinder path_finder;
 
         board::Square<uint8_t,SIZE> top;
         board::Square<Color,SIZE> color;
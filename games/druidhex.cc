@@ -81,7 +81,6 @@ typedef Game<   DruidHexState,
 //
 //----------------------------------------------------------------------------
 
-template<> MemoryPool<DruidHexUCT::Node> DruidHexUCT::Node::pool(GAME_SIZE+1);
 template<> druidhex::HexPathFinder<SIZE> DruidHexState::path_finder(0);
 
 
@@ -2,7 +2,7 @@
 #define DRUIDHEX_H
 #pragma once
 
-#include "search.h"
+#include "bitboard.h"
 #include "board.h"
 
 //#define COUNT_PIECES
@@ -14,145 +14,120 @@ enum Type { EMPTY, SARSEN, LINTEL };
 static uint8_t HIGHEST = 0;
 static const size_t MAX_HEIGHT = 256;
 
+//----------------------------------------------------------------------------
+//
+// HexPathFinder
+//
+// A player wins by joining three alternate sides of the hexagon (A, C and E
+// or B, D and F, clockwise from the top) with one group. Stones are held in
+// a WideBitboard in axial coordinates, column x+max(0,y-(SIZE-1)), where
+// every cell has the same six neighbours, and groups are grown by
+// dilation until they join the sides or stop growing.
+//
+//----------------------------------------------------------------------------
+
 template <size_t SIZE>
 struct HexPathFinder {
         typedef board::Hex<Color,SIZE> Board;
-        typedef board::Hex<bool,SIZE> BoolBoard;
-        typedef typename Board::Direction Direction;
-        typedef typename BoolBoard::Direction BoolDirection;
+        enum { DSIZE = Board::DSIZE };
+        typedef WideBitboard<DSIZE,DSIZE> BB;
 
         enum Side { A, B, C, D, E, F };
-        enum Target { ACE, BDF };
-
-        struct Point {
-                uint8_t x, y;
-                bool operator == (const Point &p) const {
-                        return x==p.x && y==p.y;
-                }
-        };
-
-        Point points[6][SIZE];
-
-        Board *map;
-        Color color;
-        board::Hex<bool,SIZE> visited;
-
-        bool edge_seen[2];
-
-        void populate_points() {
-                BoolDirection d[6] = {
-                        BoolBoard::EAST, BoolBoard::SE, BoolBoard::SW,
-                        BoolBoard::WEST, BoolBoard::NW, BoolBoard::NE
-                };
 
-                uint8_t x=0, y=0;
-                while (!visited.valid(x,y))
-                        ++x;
+        BB side[6];
 
-                assert(visited.valid(x,y));
-
-                for (size_t s=0; s < 6; ++s) {
-                        size_t i=0;
-                        for (; i < (SIZE-1); ++i) {
-                                points[s][i].x = x;
-                                points[s][i].y = y;
-                                visited.move(d[s], x, y);
+        // constructor arg seems necessary; clang bug?
+        HexPathFinder(int _dummy) { populate_sides(); }
+
+        static size_t index(uint8_t x, uint8_t y) {
+                size_t c = x + (y >= SIZE ? y-(SIZE-1) : 0);
+                return BB::index(c, y);
+        }
+
+        void populate_sides() {
+                const int last = DSIZE-1, edge = SIZE-1;
+                Board b;
+                for (uint8_t y=0; y < DSIZE; ++y) {
+                        for (uint8_t x=0; b.valid(x,y); ++x) {
+                                size_t i = index(x,y);
+                                int c = i % DSIZE;
+                                if (y == 0)        side[A].set(i);
+                                if (c-y == edge)   side[B].set(i);
+                                if (c == last)     side[C].set(i);
+                                if (y == last)     side[D].set(i);
+                                if (y-c == edge)   side[E].set(i);
+                                if (c == 0)        side[F].set(i);
                         }
-                        points[s][i].x = x;
-                        points[s][i].y = y;
                 }
         }
 
-        bool found_connection() {
-                return edge_seen[0] && edge_seen[1];
-        }
-
-        size_t edge_num(Side s) {
-                switch (s) {
-                case C: case D: return 0;
-                case E: case F: return 1;
-                case A: case B: DIE("unexpected initial side: " << s);
-                }
-                DIE("unexpected side: " << s);
+        static BB stones(Color c, const Board *m) {
+                BB b;
+                for (uint8_t y=0; y < DSIZE; ++y)
+                        for (uint8_t x=0; m->valid(x,y); ++x)
+                                if (m->get(x,y) == c)
+                                        b.set(index(x,y));
+                return b;
         }
 
-        void mark_edge2(Point & p, size_t i) {
-                size_t n = edge_num((Side) i);
-                if (!edge_seen[n])
-                        for (size_t j=0; j < SIZE; ++j)
-                                if (p == points[i][j])
-                                        edge_seen[n] = true;
-        }
+        bool touches(const BB &group, Side s) const { return (group & side[s]).any(); }
 
-        void mark_edge(Target t, uint8_t x, uint8_t y) {
-                Point p;
-                p.x = x; p.y = y;
-                for (size_t i=(t==BDF?3:2); i < 6; i += 2)
-                        mark_edge2(p, i);
+        bool joins(const BB &group) const {
+                return (touches(group, A) && touches(group, C) && touches(group, E))
+                    || (touches(group, B) && touches(group, D) && touches(group, F));
         }
 
-
-        // constructor arg seems necessary; clang bug?
-        HexPathFinder(int _dummy) : map(0), color(NONE) { populate_points(); }
-
-        bool seen(uint8_t x, uint8_t y) { return visited.get(x, y); }
-        bool mycolor(uint8_t x, uint8_t y) { return map->get(x,y) == color; }
-
-        void scan(Target t, uint8_t x, uint8_t y) {
-                visited.set(x, y, true);
-                mark_edge(t, x, y);
-                if (found_connection())
-                        return;
-
-                BoolDirection d;
-                uint8_t nx, ny;
-                for (size_t i=0; i < 6; ++i) {
-                        d = (BoolDirection) i;
-                        if (visited.has_move(d, x, y)) {
-                                nx = x, ny = y;
-                                visited.move(d, nx, ny);
-                                if (!seen(nx, ny) && mycolor(nx, ny)) {
-                                        scan(t, nx, ny);
-                                        if (found_connection())
-                                                return;
-                                }
-                        }
+        // grow group within mine; true as soon as it joins three sides
+        bool grow(BB &group, const BB &mine) const {
+                for (;;) {
+                        if (joins(group))
+                                return true;
+                        BB next = group.dilate6() & mine;
+                        if (next == group)
+                                return false;
+                        group = next;
                 }
         }
 
-        bool search(Target t) {
-                memset(&visited, 0, sizeof(visited));
-                edge_seen[0] = false;
-                edge_seen[1] = false;
-                Point p;
-                for (size_t i=0; i < SIZE; ++i) {
-                        p = points[t==BDF?1:0][i];
-                        if (mycolor(p.x, p.y)) {
-                                scan(t, p.x, p.y);
-                                if (found_connection())
-                                        return true;
-                        }
+        // every group that touches side A or B is a candidate
+        bool connected(const BB &mine) const {
+                BB seeds = mine & (side[A] | side[B]);
+                while (seeds.any()) {
+                        BB group;
+                        group.set(seeds.first());
+                        if (grow(group, mine))
+                                return true;
+                        seeds = seeds.andnot(group);
                 }
                 return false;
         }
 
-        bool connected(Color c, Board *m) {
-                map = m;
-                color = c;
-                return search(ACE) || search(BDF);
+        bool connected(Color c, Board *m) const {
+                return connected(stones(c, m));
         }
 
-        void clear(Color c, Board *m) {
-                color = c;
-                map = m;
-                memset(visited, 0, sizeof(bool)*(SIZE*SIZE));
+        // incremental test after a move: only the group holding the new
+        // stones can have made a connection
+        bool connected_from(const BB &mine, const BB &placed) const {
+                BB group = placed & mine;
+                return grow(group, mine);
         }
 
-        size_t longest(Color c, Board *m) { return 1; }
+        size_t longest(Color c, Board *m) const {
+                BB rest = stones(c, m);
+                size_t best = 0;
+                while (rest.count() > best) {
+                        BB seed;
+                        seed.set(rest.first());
+                        BB group = BB::fill6(seed, rest);
+                        best = std::max(best, group.count());
+                        rest = rest.andnot(group);
+                }
+                return best;
+        }
 };
 
 
-
 #pragma pack(1)
 template <size_t SIZE>
 struct Move {
@@ -269,6 +244,7 @@ struct State {
         typedef typename TBoard::Direction TDirection;
         typedef MoveList<SIZE, AREA> ML;
         typedef Move<SIZE> M;
+        typedef typename HexPathFinder<SIZE>::BB Bits;
 
         //--------------------------------------------------------------------
         //
@@ -287,6 +263,7 @@ struct State {
 
         board::Hex<uint8_t,SIZE> top;
         board::Hex<Color,SIZE> color;
+        Bits black_bits, white_bits; // color, for the path finder
 
 #ifdef COUNT_PIECES
         uint8_t black_sarsens, white_sarsens,
@@ -320,15 +297,16 @@ struct State {
 
         State(const State &rhs) { copy_from(rhs); }
 
+        // raw copies: the bitboards hold only words
         void copy_from(const State &rhs) {
-                memcpy(this, &rhs, sizeof(State));
+                memcpy((void *) this, (const void *) &rhs, sizeof(State));
 #ifdef USE_SCORE
                 score_cached = false;
 #endif
         }
 
         void clear() {
-                memset(this, 0, sizeof(State));
+                memset((void *) this, 0, sizeof(State));
                 _just_played = WHITE;
                 _winner = NONE;
 #ifdef USE_SCORE
@@ -342,13 +320,26 @@ struct State {
 #endif
         }
 
+        Bits& bits(Color c) {
+                assert(c != NONE);
+                return c == BLACK ? black_bits : white_bits;
+        }
+
+        void setColor(Color c, uint8_t x, uint8_t y) {
+                size_t i = path_finder.index(x, y);
+                black_bits.reset(i);
+                white_bits.reset(i);
+                bits(c).set(i);
+                color.set(x, y, c);
+        }
+
         void placeSarsen(Color c, uint8_t x, uint8_t y) {
 #ifndef NDEBUG
                 Color tc = color.get(x,y);
 #endif
                 assert(tc == NONE || tc == c);
                 top.set(x, y, top.get(x,y)+1);
-                color.set(x, y, c);
+                setColor(c, x, y);
 #ifdef COUNT_PIECES
                 switch (c) {
                 case BLACK: assert(black_sarsens > 0); black_sarsens--; break;
@@ -406,7 +397,7 @@ struct State {
 
                 for (int i=0; i < 3; ++i) {
                         top.set(ix, iy, z);
-                        color.set(ix, iy, c);
+                        setColor(c, ix, iy);
                         color.move(dir, ix, iy);
                 }
 
@@ -448,7 +439,10 @@ struct State {
                         break;
                 }
 
-                if (path_finder.connected(player, &color)) {
+                // all stones placed are in the group at (x,y)
+                Bits placed;
+                placed.set(path_finder.index(m.x(), m.y()));
+                if (path_finder.connected_from(bits(player), placed)) {
                         _winner = player;
                         _game_over = true;
                 }
@@ -5,6 +5,7 @@
 #include "minimax.h"
 #include "montecarlo.h"
 #include "td.h"
+//#define TRACE_MOVE_FINDER // recursive move finder, for comparison
 #include "tanbo.h"
 
 
@@ -77,14 +78,6 @@ typedef Game<   TanboState,
                 PLAYER_X,
                 PLAYER_Y > TanboGame;
 
-//----------------------------------------------------------------------------
-//
-// Static symbols
-//
-//----------------------------------------------------------------------------
-
-template<> MemoryPool<TanboUCT::Node> TanboUCT::Node::pool(MAX_ITER);
-
 //----------------------------------------------------------------------------
 //
 // MAIN
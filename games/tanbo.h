@@ -2,13 +2,14 @@
 #define TANBO_H
 #pragma once
 
+#include <engine/bitboard.h>
 #include <engine/board.h>
 #include <engine/memory.h>
 #include <engine/state.h>
 #include <engine/montecarlo.h>
+#ifndef HEADLESS
 #include <ui/board.h>
-
-#include <bitset>
+#endif
 
 
 namespace tanbo {
@@ -57,7 +58,9 @@ struct MoveList {
         }
 };
 
-static GBoard WINDOW(500, 500, 19);
+#ifndef HEADLESS
+static AsyncGBoard WINDOW(500, 500, 19);
+#endif
 
 
 #pragma pack(1)
@@ -71,8 +74,8 @@ struct State : BaseState {
         enum { NUM_DIRECTIONS=SW+1 };
 
 
-        bitset<SIZE*SIZE> black;
-        bitset<SIZE*SIZE> white;
+        WideBitboard<SIZE,SIZE> black;
+        WideBitboard<SIZE,SIZE> white;
 
         typedef MCMoveCounter<State, MAX_MOVES> MoveCounter;
 
@@ -239,7 +242,7 @@ struct State : BaseState {
         struct MoveFinder {
                 bool visited[SIZE*SIZE];
                 bool visited_remove[SIZE*SIZE];
-                bitset<SIZE*SIZE> occupied;
+                WideBitboard<SIZE,SIZE> occupied;
 
                 void reset() {
                         occupied.reset();
@@ -365,7 +368,68 @@ struct State : BaseState {
                 }
         };
 
+        // Same results as MoveFinder, from whole-board shifts: a point is a
+        // move for c if it is empty and has exactly one orthogonal neighbour
+        // of colour c, and a group of c is dead if none of its stones touch
+        // such a point.
+        struct BitMoveFinder {
+                typedef WideBitboard<SIZE,SIZE> BB;
+
+                static BB& stones(Color c, State &s) {
+                        return c == BLACK ? s.black : s.white;
+                }
+
+                // empty points with exactly one neighbour in mine
+                static BB single_contact(const BB &mine, const BB &empty) {
+                        BB n = mine.north(), s = mine.south(),
+                           e = mine.east(),  w = mine.west();
+                        BB one = n ^ s, two = n & s;
+                        two |= one & e;
+                        one ^= e;
+                        two |= one & w;
+                        one ^= w;
+                        return one.andnot(two) & empty;
+                }
+
+                static void add_moves(Color c, State &s, ML &ml) {
+                        BB moves = single_contact(stones(c, s), ~(s.black | s.white));
+                        while (moves.any())
+                                ml.add(moves.pop_first());
+                }
+
+                // moves for the player to move; unlike find(Color, ...) this
+                // does not count groups and returns the number of moves
+                size_t find(State &s, ML &ml) {
+                        add_moves(s.current(), s, ml);
+                        return ml.size();
+                }
+
+                size_t find(Color c, State &s, ML &ml) {
+                        add_moves(c, s, ml);
+
+                        BB rest = stones(c, s);
+                        size_t groups = 0;
+                        while (rest.any()) {
+                                BB seed;
+                                seed.set(rest.first());
+                                rest = rest.andnot(BB::fill4(seed, rest));
+                                groups++;
+                        }
+                        return groups;
+                }
+
+                void remove_dead(State &s) {
+                        BB &mine = stones(s.current(), s);
+                        BB moves = single_contact(mine, ~(s.black | s.white));
+                        mine = BB::fill4(moves.neighbours4() & mine, mine);
+                }
+        };
+
+#ifdef TRACE_MOVE_FINDER
         MoveFinder finder;
+#else
+        BitMoveFinder finder;
+#endif
 
         void moves(ML &ml) {
                 ml.clear();
@@ -379,6 +443,7 @@ struct State : BaseState {
         }
 
         void display() {
+#ifndef HEADLESS
                 WINDOW.bsize = SIZE;
                 GBoard::player_t b, w;
                 for (uint16_t i=0; i < Board::AREA; ++i) {
@@ -386,6 +451,7 @@ struct State : BaseState {
                         else if (color(i) == WHITE) w.push_back(i);
                 }
                 WINDOW.update(GBoard::GO, b, w);
+#endif
         }
 
         string str() {
@@ -402,8 +468,12 @@ struct State : BaseState {
         }
 
         void print() {
-                display();
-                return;
+#ifndef HEADLESS
+                if (WINDOW.enabled) {
+                        display();
+                        return;
+                }
+#endif
                 cout << str();
                 cout << flush;
         }
@@ -81,14 +81,6 @@ typedef Game<   TTTState,
                 PLAYER_X,
                 PLAYER_Y > TTTGame;
 
-//----------------------------------------------------------------------------
-//
-// Static symbols
-//
-//----------------------------------------------------------------------------
-
-template<> MemoryPool<TTTUCT::Node> TTTUCT::Node::pool(MAX_ITER);
-
 
 //----------------------------------------------------------------------------
 //
@@ -78,14 +78,6 @@ typedef Game<   YavalathState,
                 PLAYER_X,
                 PLAYER_Y > YavalathGame;
 
-//----------------------------------------------------------------------------
-//
-// Static symbols
-//
-//----------------------------------------------------------------------------
-
-template<> MemoryPool<YavalathUCT::Node> YavalathUCT::Node::pool(MAX_ITER);
-
 
 //----------------------------------------------------------------------------
 //
@@ -0,0 +1,106 @@
+#include <engine/symbolic.h>
+
+// Arena allocation of Node trees and hash-consing with ExprTable: checks
+// where nodes come from, that interned equal trees share one root and that
+// ExprTable::eval() agrees with Node::eval(); times building and dropping
+// copies of trees on the heap and in an arena.
+
+static Node::value_t X = 0;
+
+Node *random_tree(size_t depth) {
+        size_t r = random() % (depth == 0 ? 3 : 9);
+        switch (r) {
+        case 0:  return new Variable(&X, "x");
+        case 1:  return new Constant(random() % 4 + 1);
+        case 2:  return new Constant(random() % 4 + 1);
+        case 3:  return new Negate(random_tree(depth-1));
+        case 4:  return new Sin(random_tree(depth-1));
+        case 5:  return new Add(random_tree(depth-1), random_tree(depth-1));
+        case 6:  return new Subtract(random_tree(depth-1), random_tree(depth-1));
+        case 7:  return new Multiply(random_tree(depth-1), random_tree(depth-1));
+        default: return new Divide(random_tree(depth-1), random_tree(depth-1));
+        }
+}
+
+bool same(Node::value_t a, Node::value_t b) {
+        return (isnan(a) && isnan(b)) || a == b;
+}
+
+int main() {
+        srandom(time(NULL));
+
+        static const size_t TREES = 2000, ROUNDS = 50;
+        bool ok = true;
+
+        std::vector<Node*> trees;
+        for (size_t i=0; i < TREES; ++i)
+                trees.push_back(random_tree(8));
+
+        // placement
+        Arena arena;
+        {
+                ArenaScope scope(&arena);
+                Node *a = trees[0]->deep_copy();
+                ok = ArenaObject::from_arena(a) && arena.size() > 0 && ok;
+                {
+                        ArenaScope heap(0);
+                        Node *h = trees[0]->deep_copy();
+                        ok = !ArenaObject::from_arena(h) && ok;
+                        Node::release(h);
+                }
+                Node::release(a); // left to the arena
+        }
+        ok = !ArenaObject::from_arena(trees[0]) && ok;
+        arena.clear();
+        ok = arena.size() == 0 && ok;
+
+        // copies: heap new/delete against arena with a bulk clear
+        Stopwatch sw;
+        for (size_t r=0; r < ROUNDS; ++r)
+                for (size_t i=0; i < TREES; ++i)
+                        delete trees[i]->deep_copy();
+        double th = sw.elapsed();
+
+        sw.reset();
+        for (size_t r=0; r < ROUNDS; ++r) {
+                ArenaScope scope(&arena);
+                for (size_t i=0; i < TREES; ++i)
+                        Node::release(trees[i]->deep_copy());
+                arena.clear();
+        }
+        double ta = sw.elapsed();
+
+        // hash-consing
+        size_t nodes = 0;
+        ExprTable table;
+        std::vector<const Node*> interned;
+        for (size_t i=0; i < TREES; ++i) {
+                Node *copy = trees[i]->deep_copy();
+                const Node *n = table.intern(trees[i]);
+                ok = table.intern(copy) == n && table.intern(n) == n && ok;
+                interned.push_back(n);
+                delete copy;
+        }
+        for (size_t i=0; i < TREES; ++i)
+                nodes += Program(trees[i]).size();
+
+        size_t mismatches = 0;
+        for (int x=-20; x < 20; ++x) {
+                X = x;
+                for (size_t i=0; i < TREES; ++i)
+                        mismatches += !same(table.eval(interned[i]), trees[i]->eval());
+        }
+        ok = mismatches == 0 && ok;
+
+        LOG(TREES << " trees, " << nodes << " nodes:"
+            << " heap copies=" << th << "s"
+            << " arena copies=" << ta << "s"
+            << " interned nodes=" << table.size()
+            << " eval mismatches=" << mismatches
+            << (ok ? " ok" : " FAILED"));
+
+        table.clear();
+        for (size_t i=0; i < TREES; ++i)
+                delete trees[i];
+        return ok ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+#include <engine/neural.h>
+
+// Checks that the stacked ensemble forward pass matches the average of its
+// members, and times training and inference.
+
+static const size_t NUM_NN     = 4,
+                    NUM_INPUT  = 49,
+                    NUM_HIDDEN = 40,
+                    NUM_ROWS   = 1000;
+
+typedef EnsembleFFNet<NUM_NN,NUM_INPUT,NUM_HIDDEN,2,Tanh,Sigmoid> NN;
+
+int main() {
+        srandom(time(NULL));
+
+        NN net;
+        NN::Query q(NUM_ROWS);
+        q.randomize();
+        for (size_t r=0; r < NUM_ROWS; ++r) {
+                q.target(r, 0) = q.input(r, 0) > 0;
+                q.target(r, 1) = q.input(r, 1) * q.input(r, 2) > 0;
+        }
+
+        Stopwatch sw;
+        double before = net.train_loop(q, 0, 0.001, 1),
+               after = net.train_loop(q, 0, 0.001, 50, 100);
+        double train = sw.elapsed();
+
+        sw.reset();
+        for (size_t i=0; i < 10; ++i)
+                net.fprop(q);
+        double stacked = sw.elapsed();
+
+        NN::Query p = q;
+        arma::mat average = arma::zeros(NUM_ROWS, 2);
+        sw.reset();
+        for (size_t i=0; i < 10; ++i) {
+                average.zeros();
+                for (size_t n=0; n < NUM_NN; ++n) {
+                        net.net[n].fprop(p);
+                        average += p.output;
+                }
+        }
+        double members = sw.elapsed();
+        average /= double(NUM_NN);
+
+        double max_err = arma::abs(average - q.output).max();
+        bool ok = max_err < 1e-9 && after < before;
+
+        LOG("sse " << before << " -> " << after
+            << " train=" << train << "s"
+            << " stacked=" << stacked << "s"
+            << " members=" << members << "s"
+            << " max_err=" << max_err
+            << (ok ? " ok" : " FAILED"));
+        return ok ? 0 : 1;
+}
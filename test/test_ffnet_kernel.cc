@@ -0,0 +1,69 @@
+#include <engine/neural.h>
+
+// Compares the single precision FFNet inference kernel with the armadillo
+// forward pass on random board-like inputs, and times both.
+
+template <size_t NUM_INPUT, size_t NUM_HIDDEN, size_t NUM_OUTPUT, typename FH, typename FO>
+struct Compare {
+        typedef FFNet<NUM_INPUT,NUM_HIDDEN,NUM_OUTPUT,FH,FO> NN;
+
+        static void random_input(float *in, typename NN::Query &q, int density) {
+                for (size_t i=0; i < NUM_INPUT; ++i) {
+                        float v = 0;
+                        if (random() % 100 < density)
+                                v = (random() & 1) ? 1 : -1;
+                        in[i] = v;
+                        q.input(0, i) = v;
+                }
+        }
+
+        static bool check(const char *name, size_t n) {
+                NN net;
+                net.compile();
+
+                std::vector<float> inputs(n * NUM_INPUT);
+                std::vector<typename NN::Query> queries(n, typename NN::Query(1));
+                for (size_t i=0; i < n; ++i)
+                        random_input(&inputs[i*NUM_INPUT], queries[i], random() % 100);
+
+                Stopwatch sw;
+                for (size_t i=0; i < n; ++i)
+                        net.fprop(queries[i]);
+                double ta = sw.elapsed();
+
+                std::vector<float> outputs(n * NUM_OUTPUT);
+                sw.reset();
+                for (size_t i=0; i < n; ++i)
+                        net.fprop(&inputs[i*NUM_INPUT], &outputs[i*NUM_OUTPUT]);
+                double tk = sw.elapsed();
+
+                double max_err = 0;
+                for (size_t i=0; i < n; ++i)
+                        for (size_t k=0; k < NUM_OUTPUT; ++k)
+                                max_err = std::max(max_err,
+                                        fabs(queries[i].output(0, k) - outputs[i*NUM_OUTPUT + k]));
+
+                // training must invalidate the compiled weights
+                net.train_one(queries[0], 0.01);
+                bool ok = max_err < 1e-4 && !net.compiled;
+
+                LOG(name << ": " << n << " inputs"
+                    << " arma=" << ta << "s"
+                    << " kernel=" << tk << "s"
+                    << " max_err=" << max_err
+                    << (ok ? " ok" : " FAILED"));
+                return ok;
+        }
+};
+
+int main() {
+        srandom(time(NULL));
+
+        bool ok = true;
+        ok = Compare<9,   10,  1, Sigmoid, Sigmoid>::check("ttt sigmoid", 20000) && ok;
+        ok = Compare<49,  40,  1, Tanh,    Sigmoid>::check("7x7 tanh", 20000) && ok;
+        ok = Compare<81,  60,  3, Softplus, Linear>::check("9x9 softplus", 10000) && ok;
+        ok = Compare<361, 200, 1, Sigmoid, Sigmoid>::check("19x19 sigmoid", 2000) && ok;
+
+        return ok ? 0 : 1;
+}
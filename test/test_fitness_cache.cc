@@ -0,0 +1,120 @@
+#include <engine/symbolic.h>
+#include <engine/genetic.h>
+
+// canonical_hash() equivalences and FitnessCache eviction, counters and
+// concurrent use.
+
+static Node::value_t X[2], N[2];
+
+Node *x(size_t pool=0) { return new Variable(&X[pool], "x"); }
+Node *n(size_t pool=0) { return new Variable(&N[pool], "n"); }
+Node *c(Node::value_t v) { return new Constant(v); }
+
+bool same_hash(Node *a, Node *b) {
+        bool r = canonical_hash(a) == canonical_hash(b);
+        delete a;
+        delete b;
+        return r;
+}
+
+bool check_hash() {
+        bool ok = true;
+        ok = same_hash(new Add(x(), new Multiply(c(2), c(3))), new Add(c(6), x())) && ok;
+        ok = same_hash(new Multiply(x(), n()), new Multiply(n(), x())) && ok;
+        ok = same_hash(new Sin(x(0)), new Sin(x(1))) && ok;
+        ok = same_hash(new Negate(new Sqrt(c(4))), c(-2)) && ok;
+        ok = !same_hash(new Subtract(x(), n()), new Subtract(n(), x())) && ok;
+        ok = !same_hash(new Add(x(), c(1)), new Add(x(), c(2))) && ok;
+        ok = !same_hash(new Sin(x()), new Cos(x())) && ok;
+        ok = !same_hash(x(), n()) && ok;
+
+        Node *t = new Divide(new Add(x(), new Floor(c(2.5))), new Power(n(), c(2)));
+        Node *s = t->simplify();
+        ok = same_hash(t, s) && ok;
+
+        LOG("canonical_hash" << (ok ? " ok" : " FAILED"));
+        return ok;
+}
+
+bool check_lru() {
+        bool ok = true;
+        FitnessCache cache(FitnessCache::SHARDS * 4);
+
+        // five keys of shard 0, which holds four
+        double v;
+        for (uint64_t k=1; k <= 4; ++k)
+                cache.insert(k, k);
+        ok = cache.lookup(1, v) && v == 1 && ok; // 1 is now the most recent
+        cache.insert(5, 5);                       // evicts 2
+        ok = !cache.lookup(2, v) && ok;
+        ok = cache.lookup(1, v) && cache.lookup(3, v) && cache.lookup(5, v) && ok;
+        cache.insert(3, 30);
+        ok = cache.lookup(3, v) && v == 30 && ok;
+        ok = cache.size() == 4 && cache.hits() == 5 && cache.misses() == 1 && ok;
+
+        cache.clear();
+        ok = cache.size() == 0 && !cache.lookup(1, v) && ok;
+
+        LOG("lru" << (ok ? " ok" : " FAILED"));
+        return ok;
+}
+
+// threads insert and look up overlapping keys; values are a function of
+// the key, so any hit must return it
+struct Worker {
+        FitnessCache *cache;
+        size_t seed, errors;
+
+        void run() {
+                errors = 0;
+                uint64_t r = seed;
+                for (size_t i=0; i < 200000; ++i) {
+                        r = r * 6364136223846793005ULL + 1442695040888963407ULL;
+                        uint64_t key = ((r >> 33) % 5000) * 0x9e3779b97f4a7c15ULL;
+                        double v;
+                        if (cache->lookup(key, v))
+                                errors += v != double(key >> 11);
+                        else cache->insert(key, double(key >> 11));
+                }
+        }
+
+        static void *start(void *self) {
+                ((Worker *) self)->run();
+                return NULL;
+        }
+};
+
+bool check_threads() {
+        FitnessCache cache(2048);
+        Worker workers[NUM_THREADS];
+        pthread_t threads[NUM_THREADS];
+
+        Stopwatch sw;
+        for (size_t i=0; i < NUM_THREADS; ++i) {
+                workers[i].cache = &cache;
+                workers[i].seed = i + 1;
+                pthread_create(&threads[i], NULL, Worker::start, &workers[i]);
+        }
+        size_t errors = 0;
+        for (size_t i=0; i < NUM_THREADS; ++i) {
+                pthread_join(threads[i], NULL);
+                errors += workers[i].errors;
+        }
+
+        bool ok = errors == 0 && cache.size() <= 2048 &&
+                  cache.hits() + cache.misses() == NUM_THREADS * 200000;
+        LOG("threads: " << sw.elapsed() << "s"
+            << " size=" << cache.size()
+            << " hit_rate=" << cache.hit_rate()
+            << " errors=" << errors
+            << (ok ? " ok" : " FAILED"));
+        return ok;
+}
+
+int main() {
+        bool ok = true;
+        ok = check_hash() && ok;
+        ok = check_lru() && ok;
+        ok = check_threads() && ok;
+        return ok ? 0 : 1;
+}
@@ -1,5 +1,6 @@
 #include <engine/symbolic.h>
 #define DEEP_COPY
+#define ARENA
 #include <engine/genetic.h>
 #include <ui/plot.h>
 
@@ -92,13 +93,7 @@ struct Symbolic {
                 DIE("not reached");
         }
 
-        static void release(Node *n) {
-                if (n->arity == Node::UNARY)
-                        delete ((Unary *) n);
-                else if (n->arity == Node::BINARY)
-                        delete ((Binary *) n);
-                else delete n;
-        }
+        static void release(Node *n) { Node::release(n); }
 
         static Node *simplify(Node *n) {
                 Node *s = n->simplify();
@@ -222,7 +217,7 @@ struct Symbolic {
 
         static Node *mutate(Node *n, size_t pool) {
                 Node *m = mdescend(n, find_random(n), pool);
-                delete n;
+                release(n);
                 return m;
         }
 
@@ -287,11 +282,15 @@ double BEST=numeric_limits<double>::max();
 
 Mutex mutex;
 
+// fitness does not depend on the pool, so one cache serves all of them
+FitnessCache fitness_cache(1 << 16);
+
 void announce(Node *n, double score, size_t pool) {
         Lock l(mutex);
         
         if (score < BEST) {
                 SLOG("{" << pool << ':' << itnum[pool] << "} " << score << " "
+                        << "(cache hits " << fitness_cache.hit_rate() << ") "
                         //<< std::setprecision(numeric_limits<Node::value_t>::digits10)
                         //<< std::fixed
                         << n->str());
@@ -336,6 +335,39 @@ void test_mutate() {
 
 static const size_t NUM_TESTS = 33;
 
+// Fitness cases and their expected values; expressions are compiled and run
+// over all cases at once, with one program and result buffer per pool
+struct Samples {
+        std::vector<double> x, y;
+
+        Samples(double (*f)(double), size_t first, size_t last) {
+                for (size_t i=first; i < last; ++i) {
+                        x.push_back(i);
+                        y.push_back(f(i));
+                }
+        }
+
+        double error(const Node *n, size_t pool) const {
+                static Program programs[NUM_POOLS+1];
+                static std::vector<double> results[NUM_POOLS+1];
+
+                Program &p = programs[pool];
+                std::vector<double> &z = results[pool];
+                z.resize(x.size());
+                p.compile(n);
+                p.run_array(&Symbolic::var_x[pool], &x[0], &z[0], x.size());
+
+                double mse=0;
+                for (size_t i=0; i < x.size(); ++i) {
+                        if (isnan(z[i]))
+                                return numeric_limits<double>::max();
+                        double d = z[i] - y[i];
+                        mse += d*d;
+                }
+                return mse / double(x.size());
+        }
+};
+
 struct SolutionRow {
         static double f(double i) {
                 double mcol=0, col=0, idx=0;
@@ -353,20 +385,8 @@ struct SolutionRow {
         }
 
         static double error(const Node *n, size_t pool) {
-                double mse=0;
-                size_t count=0;
-                for (size_t i=100000; i < 100010; ++i) {
-                        // set Variable
-                        Symbolic::var_x[pool] = i;
-
-                        double z = n->eval();
-                        if (isnan(z))
-                                return numeric_limits<double>::max();
-                        double y = z - f(i);
-                        mse += y*y;
-                        ++count;
-                }
-                return mse / double(count);
+                static const Samples samples(f, 100000, 100010);
+                return samples.error(n, pool);
         }
 };
 
@@ -387,20 +407,8 @@ struct SolutionCol {
         }
 
         static double error(const Node *n, size_t pool) {
-                double mse=0;
-                size_t count=0;
-                for (size_t i=0; i < (19*(19+1)/2); ++i) {
-                        // set Variable
-                        Symbolic::var_x[pool] = i;
-
-                        double z = n->eval();
-                        if (isnan(z))
-                                return numeric_limits<double>::max();
-                        double y = z - f(i);
-                        mse += y*y;
-                        ++count;
-                }
-                return mse / double(count);
+                static const Samples samples(f, 0, 19*(19+1)/2);
+                return samples.error(n, pool);
         }
 };
 
@@ -435,18 +443,30 @@ struct NodePolicy {
 
         typedef SolutionCol T;
 
+        static double error(const Node *n, size_t pool) {
+                uint64_t key = canonical_hash(n);
+                double e;
+                if (!fitness_cache.lookup(key, e)) {
+                        e = T::error(n, pool);
+                        fitness_cache.insert(key, e);
+                }
+                return e;
+        }
+
+        static double fitness(const Node *n, size_t pool) { return error(n, pool); }
+
         static bool compare(const Node *a, const Node *b, size_t pool) {
-                const Node::value_t ea=T::error(a, pool), eb=T::error(b, pool);
+                const Node::value_t ea=error(a, pool), eb=error(b, pool);
                 return ea == eb ? (Symbolic::size(a) < Symbolic::size(b)) : ea < eb;
         }
 
         static Node *null() { return 0; }
-        static void release(Node *&n) { if (n) delete n; }
+        static void release(Node *&n) { Node::release(n); }
 
         static void iterate(Pool<Node*, NodePolicy> &p, Pool<Node*,NodePolicy> &t, size_t pool) {
                 if (best[pool].compare(p.pop[0]->str())) {
                         best[pool] = p.pop[0]->str();
-                        announce(p.pop[0], NodePolicy::T::error(p.pop[0], pool), pool);
+                        announce(p.pop[0], error(p.pop[0], pool), pool);
                 }
                 itnum[pool]++;
 
@@ -505,7 +525,15 @@ void test_big() {
                 //p.pools[i].pop[0] = (Node*) new Ceil(new Subtract(new Sqrt(new Multiply(new Constant(2), new Variable(&(Symbolic::var_x[i]), "x"))),
                  //       new Sqrt(new Sqrt(new Constant(5)))));
         //}
-        p.iterate();
+        RunControl control;
+        control.seconds = 60;
+        control.target = 0;
+        control.has_target = true;
+
+        static const char *reasons[] = { "running", "generations", "time", "target" };
+        RunControl::Reason r = p.run(control);
+        LOG("stopped (" << reasons[r] << ") after " << p.generations << " generations, "
+            << p.clock.elapsed() << "s, best error " << BEST);
 }
 
 void setup_globals() {
@@ -0,0 +1,112 @@
+#include <engine/genetic.h>
+
+#include <sched.h>
+
+// Mailbox under a producer and a consumer thread, and the stop conditions
+// of Population::run() on OneMax: 32 bit genomes, fitness the number of
+// zero bits.
+
+struct OneMax {
+        typedef uint32_t T;
+
+        static T null() { return 0; }
+        static void release(T &) {}
+        static void set_pool(T &, size_t) {}
+        static void randomize(T &x, size_t) { x = random(); }
+
+        static double fitness(T x, size_t) { return 32 - __builtin_popcount(x); }
+        static bool compare(T a, T b, size_t pool) { return fitness(a, pool) < fitness(b, pool); }
+
+        static void iterate(Pool<T,OneMax> &p, Pool<T,OneMax> &t, size_t pool) {
+                t.pop[0] = p.pop[0];
+                t.pop[1] = p.pop[1];
+                for (size_t i=2; i < p.pop.size(); ++i) {
+                        T a = p.choice(), b = p.choice(),
+                          mask = random();
+                        t.pop[i] = ((a & mask) | (b & ~mask)) ^ (1u << (random() % 32));
+                }
+                p = t;
+        }
+};
+
+typedef Population<uint32_t, OneMax> Pop;
+
+struct Producer {
+        Mailbox<size_t> *box;
+        size_t count;
+
+        static void *start(void *self) {
+                Producer *p = (Producer *) self;
+                for (size_t i=1; i <= p->count; ++i)
+                        while (!p->box->push(i))
+                                sched_yield();
+                return NULL;
+        }
+};
+
+bool check_mailbox() {
+        static const size_t COUNT = 1000000;
+        Mailbox<size_t> box;
+        Producer p = { &box, COUNT };
+        pthread_t thread;
+
+        Stopwatch sw;
+        pthread_create(&thread, NULL, Producer::start, &p);
+        size_t expected = 1, errors = 0, x;
+        while (expected <= COUNT) {
+                if (box.pop(x)) {
+                        errors += x != expected;
+                        expected = x+1;
+                } else sched_yield();
+        }
+        pthread_join(thread, NULL);
+
+        bool ok = errors == 0 && !box.pop(x);
+        LOG("mailbox: " << COUNT << " messages " << sw.elapsed() << "s"
+            << " errors=" << errors << (ok ? " ok" : " FAILED"));
+        return ok;
+}
+
+bool check_run(const char *name, const RunControl &control, RunControl::Reason expected) {
+        Pop pop(20, 4);
+        RunControl::Reason r = pop.run(control);
+
+        bool ok = r == expected;
+        if (expected == RunControl::GENERATIONS)
+                for (size_t i=0; i < pop.npools; ++i)
+                        ok = pop.age[i] == control.generations && ok;
+        if (expected == RunControl::TARGET) {
+                double best = 32;
+                for (size_t i=0; i < pop.npools; ++i)
+                        best = std::min(best, OneMax::fitness(pop.pools[i].pop[0], i));
+                ok = best <= control.target && ok;
+        }
+        if (expected == RunControl::TIME)
+                ok = pop.clock.elapsed() < control.seconds + 1 && ok;
+
+        LOG(name << ": reason=" << r << " generations=" << pop.generations
+            << " " << pop.clock.elapsed() << "s" << (ok ? " ok" : " FAILED"));
+        return ok;
+}
+
+int main() {
+        srandom(time(NULL));
+        bool ok = check_mailbox();
+
+        RunControl generations;
+        generations.generations = 500;
+        ok = check_run("generations", generations, RunControl::GENERATIONS) && ok;
+
+        RunControl target;
+        target.target = 0;
+        target.has_target = true;
+        ok = check_run("target", target, RunControl::TARGET) && ok;
+
+        RunControl time;
+        time.seconds = 0.5;
+        time.target = -1; // unreachable
+        time.has_target = true;
+        ok = check_run("time", time, RunControl::TIME) && ok;
+
+        return ok ? 0 : 1;
+}
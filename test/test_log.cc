@@ -0,0 +1,78 @@
+#include <engine/common.h>
+#include <engine/thread.h>
+
+// Logs from several threads at once with cout captured: after log_flush()
+// every line must have been written whole, once, and in order within its
+// thread; a thread that outruns the drain thread loses lines rather than
+// blocking, and the loss is reported. A line longer than LOG_LINE is cut,
+// and the lines after it are still written.
+
+static const size_t NUM_THREADS_LOGGING = 4, LINES = 500; // fit in a ring
+
+static void *logger(void *arg) {
+        size_t id = (size_t) arg;
+        for (size_t i=0; i < LINES; ++i)
+                LOG("thread " << id << " line " << i << " padding padding padding");
+        return NULL;
+}
+
+int main(int argc, char **argv) {
+        stringstream captured;
+        streambuf *old = cout.rdbuf(captured.rdbuf());
+
+        pthread_t threads[NUM_THREADS_LOGGING];
+        for (size_t i=0; i < NUM_THREADS_LOGGING; ++i)
+                pthread_create(&threads[i], NULL, logger, (void *) i);
+        for (size_t i=0; i < NUM_THREADS_LOGGING; ++i)
+                pthread_join(threads[i], NULL);
+        log_flush();
+
+        // a burst larger than a ring, faster than the drain thread runs
+        for (size_t i=0; i < 10000; ++i)
+                SLOG("burst " << i << " padding padding padding padding padding");
+        log_flush();
+
+        LOG(string(2 * LOG_LINE, 'x'));
+        LOG("after a long line");
+        log_flush();
+        cout.rdbuf(old);
+
+        vector<size_t> next(NUM_THREADS_LOGGING, 0);
+        size_t bursts = 0, last_burst = 0, dropped = 0;
+        bool cut = false, after = false;
+        string line;
+        while (getline(captured, line)) {
+                size_t id, i, d;
+                if (line.find("xxx") != string::npos) {
+                        size_t x = line.find('x');
+                        if (line.size() - x != LOG_LINE || after)
+                                DIE("long line of " << line.size() - x << " characters");
+                        cut = true;
+                } else if (line.find("] after a long line") != string::npos) {
+                        if (!cut)
+                                DIE("line after a long one out of order");
+                        after = true;
+                } else if (sscanf(line.c_str(), "[%*d] thread %zu line %zu", &id, &i) == 2) {
+                        if (id >= NUM_THREADS_LOGGING || i != next[id])
+                                DIE("out of order: " << line);
+                        next[id]++;
+                } else if (sscanf(line.c_str(), "[%*d] burst %zu", &i) == 1) {
+                        if (bursts && i <= last_burst)
+                                DIE("burst out of order: " << line);
+                        last_burst = i;
+                        bursts++;
+                } else if (sscanf(line.c_str(), "[log] %zu lines dropped", &d) == 1) {
+                        dropped += d;
+                } else DIE("unexpected line: " << line);
+        }
+        for (size_t i=0; i < NUM_THREADS_LOGGING; ++i)
+                if (next[i] != LINES)
+                        DIE("thread " << i << " wrote " << next[i] << " lines");
+        if (!cut || !after)
+                DIE("long line: cut " << cut << ", line after it " << after);
+        if (bursts + dropped != 10000)
+                DIE("burst: " << bursts << " written, " << dropped << " dropped");
+
+        LOG("ok: burst wrote " << bursts << ", dropped " << dropped);
+        return 0;
+}
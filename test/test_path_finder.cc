@@ -0,0 +1,76 @@
+#include <engine/search.h>
+
+// Compares BitSquarePathFinder with the recursive SquarePathFinder on random
+// boards and times both.
+
+template <size_t SIZE>
+struct Compare {
+        typedef board::Square<Color,SIZE> Board;
+
+        static void random_board(Board &b, int density) {
+                for (uint8_t y=0; y < SIZE; ++y) {
+                        for (uint8_t x=0; x < SIZE; ++x) {
+                                Color c = NONE;
+                                if (random() % 100 < density)
+                                        c = (random() & 1) ? BLACK : WHITE;
+                                b.set(x, y, c);
+                        }
+                }
+        }
+
+        template <typename PF>
+        static size_t run(PF &pf, std::vector<Board> &boards, double &seconds) {
+                size_t r = 0;
+                Stopwatch sw;
+                for (size_t i=0; i < boards.size(); ++i) {
+                        r = r*31 + pf.connected(BLACK, &boards[i]);
+                        r = r*31 + pf.connected(WHITE, &boards[i]);
+                        r = r*31 + pf.connected_any(BLACK, &boards[i]);
+                        r = r*31 + pf.longest(BLACK, &boards[i]);
+                        r = r*31 + pf.longest(WHITE, &boards[i]);
+                }
+                seconds = sw.elapsed();
+                return r;
+        }
+
+        static bool check(size_t n) {
+                std::vector<Board> boards(n);
+                for (size_t i=0; i < n; ++i)
+                        random_board(boards[i], random() % 100);
+
+                SquarePathFinder<SIZE> recursive(0);
+                BitSquarePathFinder<SIZE> bit(0);
+                double tr, tb;
+                size_t rr = run(recursive, boards, tr),
+                       rb = run(bit, boards, tb);
+
+                bool ok = (rr == rb);
+                for (size_t i=0; ok && i < n; ++i) {
+                        ok = ok && recursive.connected(BLACK, &boards[i]) == bit.connected(BLACK, &boards[i])
+                                && recursive.connected(WHITE, &boards[i]) == bit.connected(WHITE, &boards[i])
+                                && recursive.connected_any(WHITE, &boards[i]) == bit.connected_any(WHITE, &boards[i])
+                                && recursive.longest(BLACK, &boards[i]) == bit.longest(BLACK, &boards[i])
+                                && recursive.longest(WHITE, &boards[i]) == bit.longest(WHITE, &boards[i]);
+                        if (!ok)
+                                LOG(SIZE << "x" << SIZE << ": mismatch on board " << i);
+                }
+
+                LOG(SIZE << "x" << SIZE << ": " << n << " boards"
+                    << " recursive=" << tr << "s"
+                    << " bit=" << tb << "s"
+                    << (ok ? " ok" : " FAILED"));
+                return ok;
+        }
+};
+
+int main() {
+        srandom(time(NULL));
+
+        bool ok = true;
+        ok = Compare<5>::check(100000) && ok;
+        ok = Compare<9>::check(50000) && ok;
+        ok = Compare<13>::check(20000) && ok;
+        ok = Compare<19>::check(10000) && ok;
+
+        return ok ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+#include <engine/pipeline.h>
+
+#include <map>
+
+// Streams positions of recorded random games through PositionStream: every
+// position reached must come out once per epoch with its game's result, in
+// full minibatches except the last, and stopping early must not hang.
+
+#pragma pack(push, 1)
+struct Move {
+        uint8_t cell;
+};
+#pragma pack(pop)
+
+// 9 cells filled in turn; features are 1 for black, -1 for white, and the
+// game id in the last feature so positions of different games differ
+struct State {
+        typedef Move M;
+        static const size_t SIZE = 10;
+        int8_t cell[9];
+        size_t ply;
+        float game;
+
+        void clear() { memset(this, 0, sizeof(*this)); }
+        void move(const M &m) {
+                if (ply == 0)
+                        game = m.cell; // first move encodes the game, see main
+                else cell[m.cell] = (ply % 2) ? -1 : 1;
+                ply++;
+        }
+        float operator[] (size_t i) { return i < 9 ? cell[i] : game; }
+};
+
+static const char *PATH = "/tmp/test_pipeline.bin";
+static const size_t NUM_GAMES = 50, BATCH = 16, EPOCHS = 3;
+
+typedef PositionStream<State, State::SIZE> Stream;
+typedef std::map<vector<float>, size_t> Counts;
+
+static vector<float> row(const arma::mat &m, size_t i, size_t n) {
+        vector<float> r(n);
+        for (size_t j=0; j < n; ++j)
+                r[j] = m(i, j);
+        return r;
+}
+
+int main(int argc, char **argv) {
+        unlink(PATH);
+        srandom(1);
+
+        // expected: every position after each move, with the result appended
+        Counts expected;
+        size_t total = 0;
+        {
+                RecordWriter<Move> writer(PATH);
+                for (size_t g=0; g < NUM_GAMES; ++g) {
+                        State s;
+                        s.clear();
+                        Color winner = (Color) (g % 3);
+                        float result = result_target(winner);
+                        writer.begin(g);
+                        size_t n = 1 + random() % 9;
+                        for (size_t i=0; i < n; ++i) {
+                                Move m;
+                                m.cell = (i == 0) ? g : i-1;
+                                writer.add(m);
+                                s.move(m);
+                                vector<float> r;
+                                for (size_t j=0; j < State::SIZE; ++j)
+                                        r.push_back(s[j]);
+                                r.push_back(result);
+                                expected[r] += EPOCHS;
+                                total++;
+                        }
+                        writer.end(winner);
+                }
+        }
+
+        RecordReader<Move> reader(PATH);
+        Counts seen;
+        size_t batches = 0, rows = 0;
+        {
+                Stream stream(reader, BATCH, 64);
+                stream.start(EPOCHS);
+                while (const Stream::Minibatch *b = stream.next()) {
+                        if (b->input.n_cols != State::SIZE + 1 || b->input.n_rows != b->size)
+                                DIE("wrong minibatch shape");
+                        for (size_t i=0; i < b->size; ++i) {
+                                if (b->input(i, State::SIZE) != 1)
+                                        DIE("missing bias");
+                                vector<float> r = row(b->input, i, State::SIZE);
+                                r.push_back(b->target(i, 0));
+                                seen[r]++;
+                        }
+                        rows += b->size;
+                        if (b->size != BATCH && rows != total * EPOCHS)
+                                DIE("short minibatch before the end");
+                        batches++;
+                        stream.release();
+                }
+        }
+        if (rows != total * EPOCHS || seen != expected)
+                DIE("streamed " << rows << " positions, expected " << total * EPOCHS);
+
+        // stopped while the producer is blocked on a full queue
+        {
+                Stream stream(reader, 4, 8, false);
+                stream.start(100);
+                const Stream::Minibatch *b = stream.next();
+                if (!b || b->input.n_cols != State::SIZE)
+                        DIE("wrong minibatch without bias");
+                stream.release();
+        }
+
+        unlink(PATH);
+        LOG("ok: " << batches << " minibatches of " << rows << " positions");
+        return 0;
+}
@@ -0,0 +1,116 @@
+#include <engine/uct.h>
+#include <engine/minimax.h>
+#include <engine/game.h>
+#include <engine/random.h>
+#include <engine/montecarlo.h>
+#include <games/ttt.h>
+
+// Pondering: after an engine moves, it searches the opponent's turn until
+// its next move. The tree UCT grew under the reply actually played, and the
+// scores BasicMinimax found after it, must be picked up by next(); a
+// position that was not searched must not be matched. Whole games with a
+// pondering engine must play through, stopping the search on every move.
+
+typedef ttt::State<4> TTTState;
+typedef UCT<TTTState, 2000, TTTState::Board::AREA> TTTUCT;
+typedef BasicMinimax<TTTState, Negamax<TTTState>, 2> TTTNegamax;
+
+template <typename E>
+void wait_ponder(E &engine) {
+        while (!engine.ponder.finished())
+                usleep(1000);
+}
+
+// a reply of the opponent's, played on a copy of state
+static void reply(TTTState &state, TTTState &after) {
+        TTTState::ML ml;
+        after.copy_from(state);
+        ml.clear();
+        after.moves(ml);
+        after.move(ml[random() % ml.size()]);
+}
+
+void test_uct() {
+        TTTUCT uct;
+        uct.set_ponder(true);
+
+        TTTState state, after;
+        state.clear();
+        uct.next(BLACK, state);
+        wait_ponder(uct);
+        reply(state, after);
+
+        TTTUCT::Node *root = uct.ponder_reuse(after);
+        if (!root)
+                DIE("uct: the reply was not found");
+        if (root->visits == 0 || root->parent)
+                DIE("uct: reused root has " << root->visits << " visits");
+        LOG("uct: reusing " << root->visits << " visits");
+
+        // a position two plies on was not searched
+        uct.next(BLACK, after);
+        wait_ponder(uct);
+        TTTState later;
+        reply(after, later);
+        reply(later, later);
+        if (uct.ponder_reuse(later))
+                DIE("uct: matched a position that was not searched");
+}
+
+void test_minimax() {
+        TTTNegamax negamax;
+        negamax.set_ponder(true);
+
+        TTTState state, after;
+        state.clear();
+        negamax.next(BLACK, state);
+        wait_ponder(negamax);
+        reply(state, after);
+
+        const vector<int> *known = negamax.ponder_reuse(BLACK, after);
+        if (!known)
+                DIE("minimax: the reply was not found");
+
+        // the same scores as a search of the position itself
+        TTTState::ML ml;
+        ml.clear();
+        after.moves(ml);
+        if (known->size() != ml.size())
+                DIE("minimax: " << known->size() << " of " << ml.size() << " scores");
+        for (size_t i=0; i < ml.size(); ++i) {
+                TTTState child;
+                child.copy_from(after);
+                child.move(ml[i]);
+                int s = TTTNegamax::search_child(child, true);
+                if (s != (*known)[i])
+                        DIE("minimax: score " << i << " is " << (*known)[i] << ", not " << s);
+        }
+        LOG("minimax: reusing " << known->size() << " scores");
+
+        // the engine's own colour must match
+        negamax.next(BLACK, after);
+        wait_ponder(negamax);
+        reply(after, state);
+        if (negamax.ponder_reuse(WHITE, state))
+                DIE("minimax: matched for the other colour");
+}
+
+template <typename G>
+void test_games(const char *name) {
+        for (size_t i=0; i < 5; ++i) {
+                G game;
+                game.black.set_ponder(true);
+                game.play(false);
+        }
+        LOG(name << ": games played");
+}
+
+int main(int argc, char **argv) {
+        srandom(1);
+        test_uct();
+        test_minimax();
+        test_games<Game<TTTState, TTTUCT, Random<TTTState> > >("uct");
+        test_games<Game<TTTState, TTTNegamax, Random<TTTState> > >("minimax");
+        LOG("ok");
+        return 0;
+}
@@ -0,0 +1,132 @@
+#include <engine/quantized.h>
+#include <engine/montecarlo.h>
+#include <games/connect4.h>
+
+// Accuracy and speed of QuantizedFFNet against the float FFNet kernel.
+// Positions are recorded from random connect4 games; for each one the
+// children are scored by both nets and the chosen (highest) move compared.
+
+static const size_t GAMES = 2000;
+
+typedef connect4::State<7,6> C4State;
+static const size_t C4_INPUT = 2 * C4State::Board::AREA;
+
+template <size_t NUM_INPUT, size_t NUM_HIDDEN, typename FH>
+struct Report {
+        typedef FFNet<NUM_INPUT,NUM_HIDDEN,1,FH,Sigmoid> NN;
+        typedef QuantizedFFNet<NUM_INPUT,NUM_HIDDEN,1,FH,Sigmoid> QNN;
+
+        // inputs of every child of every position, grouped by position
+        std::vector<float> inputs;
+        std::vector<size_t> first;
+
+        template <typename S>
+        void record(size_t games) {
+                S child;
+                for (size_t g=0; g < games; ++g) {
+                        S s;
+                        while (!s.game_over()) {
+                                typename S::ML ml;
+                                s.moves(ml);
+                                if (ml.size() == 0)
+                                        break;
+                                first.push_back(inputs.size() / NUM_INPUT);
+                                for (size_t i=0; i < ml.size(); ++i) {
+                                        child.copy_from(s);
+                                        child.move(ml[i]);
+                                        for (size_t j=0; j < NUM_INPUT; ++j)
+                                                inputs.push_back(child[j]);
+                                }
+                                s.move(ml[random() % ml.size()]);
+                        }
+                }
+                first.push_back(inputs.size() / NUM_INPUT);
+        }
+
+        void random_boards(size_t positions, size_t children) {
+                for (size_t p=0; p < positions; ++p) {
+                        first.push_back(inputs.size() / NUM_INPUT);
+                        int density = random() % 100;
+                        for (size_t i=0; i < children * NUM_INPUT; ++i) {
+                                float v = 0;
+                                if (random() % 100 < density)
+                                        v = (random() & 1) ? 1 : -1;
+                                inputs.push_back(v);
+                        }
+                }
+                first.push_back(inputs.size() / NUM_INPUT);
+        }
+
+        template <typename N>
+        static double run(const N &net, const std::vector<float> &in, std::vector<float> &out) {
+                Stopwatch sw;
+                for (size_t i=0; i < out.size(); ++i)
+                        net.fprop(&in[i*NUM_INPUT], &out[i]);
+                return sw.elapsed();
+        }
+
+        static size_t best(const std::vector<float> &out, size_t a, size_t b) {
+                size_t r = a;
+                for (size_t i=a; i < b; ++i)
+                        if (out[i] > out[r])
+                                r = i;
+                return r;
+        }
+
+        bool check(const char *name) {
+                NN net;
+                net.compile();
+                QNN qnet(net);
+
+                size_t n = inputs.size() / NUM_INPUT;
+                std::vector<float> fo(n), qo(n);
+                double tf = run(net, inputs, fo),
+                       tq = run(qnet, inputs, qo);
+
+                double max_err = 0, sum_err = 0;
+                for (size_t i=0; i < n; ++i) {
+                        double e = fabs(fo[i] - qo[i]);
+                        max_err = std::max(max_err, e);
+                        sum_err += e;
+                }
+
+                size_t agree = 0, positions = first.size()-1;
+                for (size_t p=0; p < positions; ++p)
+                        agree += best(fo, first[p], first[p+1]) == best(qo, first[p], first[p+1]);
+
+                double agreement = double(agree) / positions;
+                bool ok = max_err < 0.05 && agreement > 0.8;
+                LOG(name << ": " << n << " evaluations"
+                    << " float=" << tf << "s"
+                    << " int8=" << tq << "s"
+                    << " speedup=" << (tq > 0 ? tf/tq : 0)
+                    << " max_err=" << max_err
+                    << " mean_err=" << sum_err / n
+                    << " same_move=" << agreement
+                    << (ok ? " ok" : " FAILED"));
+                return ok;
+        }
+};
+
+int main() {
+        srandom(time(NULL));
+
+        bool ok = true;
+        {
+                Report<C4_INPUT, 64, Sigmoid> r;
+                r.record<C4State>(GAMES);
+                ok = r.check("connect4 sigmoid") && ok;
+        }
+        {
+                Report<C4_INPUT, 128, Tanh> r;
+                r.record<C4State>(GAMES);
+                ok = r.check("connect4 tanh") && ok;
+        }
+        {
+                Report<361, 256, Sigmoid> r;
+                r.random_boards(200, 50);
+                ok = r.check("19x19 sigmoid") && ok;
+        }
+
+        return ok ? 0 : 1;
+}
@@ -0,0 +1,63 @@
+#include <engine/rbm.h>
+
+// Minibatch CD and PCD training of FloatRBM on random two-plane board
+// positions: checks the reconstruction error falls, and times one epoch
+// with one thread and with NUM_THREADS.
+
+static const size_t BOARD_AREA  = 64,
+                    NUM_VISIBLE = BOARD_AREA*2,
+                    NUM_HIDDEN  = 64,
+                    NUM_ROWS    = 20000,
+                    BATCH_SIZE  = 100,
+                    NUM_EPOCHS  = 5;
+
+static const float LEARNING_RATE = .1;
+
+arma::fmat rand_boards(size_t rows) {
+        arma::fmat m = arma::zeros<arma::fmat>(rows, NUM_VISIBLE);
+
+        for (size_t s=0; s < rows; ++s) {
+                size_t stones = random() % BOARD_AREA;
+                bool is_black = true;
+                for (size_t i=0; i < stones; ++i) {
+                        size_t pos;
+                        do {
+                                pos = random() % BOARD_AREA;
+                        } while (m(s, pos*2) != 0 || m(s, pos*2+1) != 0);
+
+                        m(s, pos*2 + (is_black ? 0 : 1)) = 1;
+                        is_black = !is_black;
+                }
+        }
+        return m;
+}
+
+bool check(const char *name, const arma::fmat &data, bool persistent, size_t threads) {
+        FloatRBM rbm(NUM_VISIBLE, NUM_HIDDEN, LEARNING_RATE);
+
+        float first = rbm.train_minibatch(data, BATCH_SIZE, 1, persistent, threads);
+        Stopwatch sw;
+        float last = rbm.train_minibatch(data, BATCH_SIZE, NUM_EPOCHS, persistent, threads);
+        double seconds = sw.elapsed() / NUM_EPOCHS;
+
+        bool ok = last < first;
+        LOG(name << ": threads=" << threads
+            << " error " << first << " -> " << last
+            << " epoch=" << seconds << "s"
+            << (ok ? " ok" : " FAILED"));
+        return ok;
+}
+
+int main() {
+        srandom(time(NULL));
+
+        arma::fmat data = rand_boards(NUM_ROWS);
+
+        bool ok = true;
+        ok = check("cd",  data, false, 1) && ok;
+        ok = check("cd",  data, false, NUM_THREADS) && ok;
+        ok = check("pcd", data, true,  1) && ok;
+        ok = check("pcd", data, true,  NUM_THREADS) && ok;
+
+        return ok ? 0 : 1;
+}
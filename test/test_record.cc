@@ -0,0 +1,159 @@
+#include <engine/record.h>
+
+// Records random games of a small synthetic game, reads them back through
+// the mapped reader and replays them: the positions, winners, parameters and
+// visit distributions must match what was played, including games without
+// moves. Each game must be readable as soon as end() returns. A file cut
+// short in the middle of a game must still read up to the last complete one,
+// and games appended to it must follow that one.
+
+#pragma pack(push, 1)
+struct Move {
+        uint8_t x, y;
+};
+#pragma pack(pop)
+
+// 4x4 board filled in turn; the game ends after a random number of moves
+struct State {
+        typedef Move M;
+        uint8_t cell[16];
+        size_t ply;
+
+        void clear() { memset(this, 0, sizeof(*this)); }
+        void move(const M &m) { cell[m.y*4 + m.x] = 1 + (ply++ % 2); }
+        bool same_position(const State &s) const { return !memcmp(cell, s.cell, sizeof(cell)); }
+};
+
+static const char *PATH = "/tmp/test_record.bin";
+static const size_t NUM_GAMES = 100;
+
+struct Played {
+        State final;
+        vector<Move> moves;
+        Color winner;
+        RecordWriter<Move>::Visits visits;
+};
+
+static Move random_move(const State &s) {
+        Move m;
+        do {
+                m.x = random() % 4;
+                m.y = random() % 4;
+        } while (s.cell[m.y*4 + m.x]);
+        return m;
+}
+
+int main(int argc, char **argv) {
+        unlink(PATH);
+        srandom(1);
+
+        vector<Played> played(NUM_GAMES);
+        {
+                RecordWriter<Move> writer(PATH);
+                for (size_t g=0; g < NUM_GAMES; ++g) {
+                        Played &p = played[g];
+                        bool visits = g % 2;
+                        p.final.clear();
+                        writer.begin(1000 + g, g, -(float) g);
+                        size_t n = g % 10 ? 1 + random() % 16 : 0;
+                        for (size_t i=0; i < n; ++i) {
+                                Move m = random_move(p.final);
+                                p.final.move(m);
+                                p.moves.push_back(m);
+                                if (visits) {
+                                        // the last move's distribution is kept for checking
+                                        p.visits.clear();
+                                        for (size_t j=0; j <= i; ++j)
+                                                p.visits.push_back(std::make_pair(m, j * 7));
+                                        writer.add(m, p.visits);
+                                } else writer.add(m);
+                        }
+                        p.winner = (Color) (random() % 3);
+                        writer.end(p.winner);
+                }
+
+                // still open: every ended game is already in the file
+                RecordReader<Move> reader(PATH);
+                if (reader.size() != NUM_GAMES)
+                        DIE("read " << reader.size() << " games before close, wrote " << NUM_GAMES);
+        }
+
+        {
+                RecordReader<Move> reader(PATH);
+                if (reader.size() != NUM_GAMES)
+                        DIE("read " << reader.size() << " games, wrote " << NUM_GAMES);
+                for (size_t g=0; g < NUM_GAMES; ++g) {
+                        GameRecord<Move> r = reader[g];
+                        const Played &p = played[g];
+                        if (r.id() != 1000 + g || r.param(BLACK) != g || r.param(WHITE) != -(float) g)
+                                DIE("game " << g << ": wrong header");
+                        if (r.winner() != p.winner || r.size() != p.moves.size())
+                                DIE("game " << g << ": wrong winner or length");
+                        if (r.has_visits() != (g % 2))
+                                DIE("game " << g << ": wrong visits flag");
+
+                        Replay<State> replay(r);
+                        for (; !replay.done(); replay.advance()) {
+                                Move m = replay.move();
+                                if (memcmp(&m, &p.moves[replay.ply], sizeof(m)))
+                                        DIE("game " << g << ": wrong move " << replay.ply);
+                                if (replay.state.cell[m.y*4 + m.x])
+                                        DIE("game " << g << ": replayed onto an occupied cell");
+                        }
+                        if (!replay.state.same_position(p.final))
+                                DIE("game " << g << ": wrong final position");
+
+                        if (r.has_visits()) {
+                                size_t last = r.size() - 1;
+                                if (r.num_visits(last) != p.visits.size())
+                                        DIE("game " << g << ": wrong visit count");
+                                for (size_t j=0; j < p.visits.size(); ++j)
+                                        if (r.visit(last, j).visits != p.visits[j].second)
+                                                DIE("game " << g << ": wrong visits");
+                        }
+                }
+        }
+
+        // cut into the last game
+        struct stat st;
+        stat(PATH, &st);
+        if (truncate(PATH, st.st_size - 3) < 0)
+                DIE("truncate failed");
+        {
+                RecordReader<Move> reader(PATH);
+                if (reader.size() != NUM_GAMES - 1)
+                        DIE("truncated file read " << reader.size() << " games");
+        }
+
+        // append after the cut: the partial game must be dropped
+        {
+                RecordWriter<Move> writer(PATH);
+                for (size_t g=0; g < 3; ++g) {
+                        writer.begin(2000 + g);
+                        for (size_t i=0; i <= g; ++i) {
+                                Move m = { (uint8_t) i, (uint8_t) g };
+                                writer.add(m);
+                        }
+                        writer.end(BLACK);
+                }
+        }
+        {
+                RecordReader<Move> reader(PATH);
+                if (reader.size() != NUM_GAMES - 1 + 3)
+                        DIE("appended file read " << reader.size() << " games");
+                if (reader[NUM_GAMES - 2].id() != 1000 + NUM_GAMES - 2)
+                        DIE("appending changed the last complete game");
+                for (size_t g=0; g < 3; ++g) {
+                        GameRecord<Move> r = reader[NUM_GAMES - 1 + g];
+                        if (r.id() != 2000 + g || r.size() != g + 1 || r.winner() != BLACK)
+                                DIE("appended game " << g << ": wrong header");
+                        for (size_t i=0; i <= g; ++i)
+                                if (r.move(i).x != i || r.move(i).y != g)
+                                        DIE("appended game " << g << ": wrong move " << i);
+                }
+        }
+
+        unlink(PATH);
+        LOG("ok");
+        return 0;
+}
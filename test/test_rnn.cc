@@ -109,6 +109,8 @@ struct NodePolicy {
                 return a.score > b.score;
         }
 
+        static double fitness(const Neuron &n, size_t pool) { return -n.score; }
+
         static void iterate(Pool<Neuron,NodePolicy> &p, Pool<Neuron,NodePolicy> &t, size_t pool) {
         }
 };
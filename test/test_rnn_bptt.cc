@@ -0,0 +1,53 @@
+#include <engine/rnn.h>
+
+// Trains the RNN with truncated BPTT to repeat its input from DELAY steps
+// earlier, on a batch of independent random sequences, and checks the error
+// falls.
+
+static const size_t NUM_HIDDEN = 12,
+                    BATCH      = 64,
+                    LENGTH     = 40,
+                    TRUNCATE   = 10,
+                    DELAY      = 2,
+                    EPOCHS     = 500;
+
+static const double LEARNING_RATE = 0.002;
+
+typedef RNN<1, NUM_HIDDEN, 1, Tanh, Tanh> NN;
+
+void random_sequences(std::vector<arma::mat> &input, std::vector<arma::mat> &target) {
+        input.resize(LENGTH);
+        target.resize(LENGTH);
+        for (size_t t=0; t < LENGTH; ++t) {
+                input[t].set_size(BATCH, 1);
+                for (size_t b=0; b < BATCH; ++b)
+                        input[t](b, 0) = (random() & 1) ? 0.5 : -0.5;
+                target[t] = (t >= DELAY) ? input[t-DELAY] : arma::zeros(BATCH, 1);
+        }
+}
+
+int main() {
+        srandom(time(NULL));
+
+        NN rnn;
+        std::vector<arma::mat> input, target;
+
+        Stopwatch sw;
+        double first = 0, last = 0;
+        for (size_t e=0; e < EPOCHS; ++e) {
+                random_sequences(input, target);
+                double sse = rnn.train(input, target, TRUNCATE, LEARNING_RATE)
+                           / double(BATCH * LENGTH);
+                if (e == 0)
+                        first = sse;
+                last = sse;
+                if ((e % 100) == 0)
+                        LOG("epoch " << e << ": mse=" << sse);
+        }
+
+        bool ok = last < first / 4;
+        LOG("mse " << first << " -> " << last
+            << " time=" << sw.elapsed() << "s"
+            << (ok ? " ok" : " FAILED"));
+        return ok ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+#include <engine/tournament.h>
+
+// Tournament on a synthetic game whose outcome is drawn from the Elo
+// difference of the players' parameters: the SPRT must pick the stronger
+// setting, and the reported interval must contain the true difference. A
+// one-sided score must still give a lower bound, with no upper one.
+
+struct Player {
+        float elo;
+        Player() : elo(0) {}
+        void set_param(float p) { elo = p; }
+};
+
+struct EloGame {
+        Player black, white;
+
+        void set_param(Color c, float p) {
+                if (c == BLACK) black.set_param(p);
+                else white.set_param(p);
+        }
+
+        Color play(bool verbose) {
+                static const double DRAWS = 0.3;
+                double e = MatchScore::elo_to_score(black.elo - white.elo),
+                       r = randf();
+                // expected score e with a draw rate of DRAWS
+                if (r < e - DRAWS/2) return BLACK;
+                if (r < e + DRAWS/2) return NONE;
+                return WHITE;
+        }
+};
+
+bool check(float a, float b, Tournament<EloGame>::Decision expected, size_t workers) {
+        Tournament<EloGame> t(a, b, 5000);
+        t.workers = workers;
+        Stopwatch sw;
+        Tournament<EloGame>::Decision d = t.run();
+        t.report();
+
+        double low, high;
+        t.result.elo_interval(low, high);
+        bool covered = low < high && low <= a-b && a-b <= high;
+        bool ok = d == expected && t.result.games() < 5000 && covered;
+        LOG("workers=" << t.workers << " games=" << t.result.games()
+            << " " << sw.elapsed() << "s"
+            << (covered ? " interval covers " : " interval misses ") << a-b
+            << (ok ? " ok" : " FAILED"));
+        return ok;
+}
+
+bool check_one_sided(size_t wins, size_t draws) {
+        MatchScore m;
+        m.wins = wins;
+        m.draws = draws;
+        double low, high;
+        m.elo_interval(low, high);
+        bool ok = low > 0 && low < 1000 && high == HUGE_VAL
+                  && (draws || m.elo() == HUGE_VAL);
+        LOG(wins << '-' << draws << "-0: elo=" << m.elo() << " [" << low << ", " << high << "]"
+            << (ok ? " ok" : " FAILED"));
+        return ok;
+}
+
+int main() {
+        srandom(1);
+        bool ok = true;
+        ok = check_one_sided(9, 0) && ok;
+        ok = check_one_sided(10, 2) && ok;
+        ok = check(100, 0, Tournament<EloGame>::A_BETTER, 1) && ok;
+        ok = check(0, 60, Tournament<EloGame>::B_BETTER, 4) && ok;
+        ok = check(400, 0, Tournament<EloGame>::A_BETTER, NUM_THREADS) && ok;
+        return ok ? 0 : 1;
+}
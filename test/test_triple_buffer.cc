@@ -0,0 +1,49 @@
+#include <ui/board.h>
+
+// A writer publishes numbered values through a TripleBuffer as fast as it
+// can while a slower reader fetches them: the reader must only ever see
+// whole values, in increasing order, and must see the last one.
+
+static const size_t VALUES = 1000000;
+
+struct Value {
+        size_t n, copy[16]; // a torn read shows as a mismatch
+};
+
+static TripleBuffer<Value> buffer;
+
+static void *writer(void *arg) {
+        for (size_t i=1; i <= VALUES; ++i) {
+                Value &v = buffer.write_slot();
+                v.n = i;
+                for (size_t j=0; j < 16; ++j)
+                        v.copy[j] = i;
+                buffer.publish();
+        }
+        return NULL;
+}
+
+int main(int argc, char **argv) {
+        pthread_t thread;
+        pthread_create(&thread, NULL, writer, NULL);
+
+        size_t last = 0, seen = 0;
+        while (last < VALUES) {
+                if (!buffer.fetch())
+                        continue;
+                const Value &v = buffer.read_slot();
+                for (size_t j=0; j < 16; ++j)
+                        if (v.copy[j] != v.n)
+                                DIE("torn value " << v.n << " / " << v.copy[j]);
+                if (v.n <= last)
+                        DIE("value " << v.n << " after " << last);
+                last = v.n;
+                seen++;
+        }
+        pthread_join(thread, NULL);
+        if (buffer.fetch())
+                DIE("fresh value after the last one");
+
+        LOG("ok: " << seen << " of " << VALUES << " values seen");
+        return 0;
+}
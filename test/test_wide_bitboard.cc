@@ -0,0 +1,130 @@
+#include <engine/bitboard.h>
+
+#include <bitset>
+
+// Checks WideBitboard against a std::bitset reference with per-square
+// neighbour arithmetic, on random boards of a few sizes.
+
+template <size_t W, size_t H>
+struct Check {
+        typedef WideBitboard<W,H> BB;
+        typedef bitset<W*H> Ref;
+
+        size_t failures;
+
+        Check() : failures(0) {}
+
+        void expect(bool ok, const char *what, const BB &b) {
+                if (ok)
+                        return;
+                ++failures;
+                LOG(W << "x" << H << ": " << what << " failed on" << endl << b.str());
+        }
+
+        static void random_board(BB &b, Ref &r, int density) {
+                b.reset();
+                r.reset();
+                for (size_t i=0; i < W*H; ++i) {
+                        if (random() % 100 < density) {
+                                b.set(i);
+                                r.set(i);
+                        }
+                }
+        }
+
+        static bool same(const BB &b, const Ref &r) {
+                for (size_t i=0; i < W*H; ++i)
+                        if (b[i] != r[i])
+                                return false;
+                return b.count() == r.count();
+        }
+
+        static Ref ref_shift(const Ref &r, int dx, int dy) {
+                Ref out;
+                for (size_t y=0; y < H; ++y) {
+                        for (size_t x=0; x < W; ++x) {
+                                int nx = x+dx, ny = y+dy;
+                                if (r[x+y*W] && nx >= 0 && ny >= 0 && nx < (int) W && ny < (int) H)
+                                        out.set(nx+ny*W);
+                        }
+                }
+                return out;
+        }
+
+        static Ref ref_fill(const Ref &seed, const Ref &mask, const int (*d)[2], size_t nd) {
+                Ref out = seed & mask, prev;
+                while (out != prev) {
+                        prev = out;
+                        for (size_t k=0; k < nd; ++k)
+                                out |= ref_shift(prev, d[k][0], d[k][1]) & mask;
+                }
+                return out;
+        }
+
+        void run(size_t rounds) {
+                static const int dir[8][2] = {
+                        { 0,-1 }, { 0, 1 }, { 1, 0 }, {-1, 0 },   // N S E W
+                        { 1,-1 }, {-1,-1 }, { 1, 1 }, {-1, 1 },   // NE NW SE SW
+                };
+                static const int d4[4][2] = { { 0,-1 }, { 0, 1 }, { 1, 0 }, {-1, 0 } };
+                static const int d6[6][2] = { { 0,-1 }, { 0, 1 }, { 1, 0 }, {-1, 0 }, {-1,-1 }, { 1, 1 } };
+
+                for (size_t n=0; n < rounds; ++n) {
+                        BB a, b;
+                        Ref ra, rb;
+                        random_board(a, ra, random() % 100);
+                        random_board(b, rb, random() % 100);
+
+                        expect(same(a, ra), "set", a);
+                        expect(same(a & b, ra & rb), "and", a);
+                        expect(same(a | b, ra | rb), "or", a);
+                        expect(same(a ^ b, ra ^ rb), "xor", a);
+                        expect(same(~a, ~ra), "not", a);
+                        expect(same(a.andnot(b), ra & ~rb), "andnot", a);
+
+                        for (size_t d=0; d < 8; ++d)
+                                expect(same(a.shift((typename BB::Direction) d),
+                                            ref_shift(ra, dir[d][0], dir[d][1])), "shift", a);
+
+                        BB c(a);
+                        size_t k = 0;
+                        while (c.any()) {
+                                size_t i = c.pop_first();
+                                expect(i == a.nth(k), "nth", a);
+                                expect(ra[i], "pop_first", a);
+                                ++k;
+                        }
+                        expect(k == ra.count() && c.first() == BB::AREA, "iteration", a);
+
+                        BB seed;
+                        Ref rseed;
+                        random_board(seed, rseed, 2);
+                        expect(same(BB::fill4(seed, a), ref_fill(rseed, ra, d4, 4)), "fill4", a);
+                        expect(same(BB::fill6(seed, a), ref_fill(rseed, ra, d6, 6)), "fill6", a);
+                        expect(same(BB::fill8(seed, a), ref_fill(rseed, ra, dir, 8)), "fill8", a);
+                }
+                LOG(W << "x" << H << ": " << rounds << " rounds, " << failures << " failures");
+        }
+};
+
+template <size_t W, size_t H>
+size_t check(size_t rounds) {
+        Check<W,H> c;
+        c.run(rounds);
+        return c.failures;
+}
+
+int main() {
+        srandom(time(NULL));
+
+        size_t failures = 0;
+        failures += check<7,7>(1000);
+        failures += check<8,8>(1000);
+        failures += check<9,9>(1000);
+        failures += check<11,11>(1000);  // 6x6 hex in axial coordinates
+        failures += check<13,13>(1000);
+        failures += check<19,19>(1000);
+        failures += check<19,5>(1000);
+
+        return failures ? 1 : 0;
+}
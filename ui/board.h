@@ -1,5 +1,11 @@
 #include "ui.h"
 
+// default packing, in case a game header included before this one left
+// #pragma pack(1) set: the TripleBuffer index is updated atomically
+#pragma pack(push)
+#pragma pack()
+#include <pthread.h>
+#include <unistd.h>
 #include <vector>
 
 static const double SQRT_3 = 1.73205080757;
@@ -195,3 +201,167 @@ struct GBoard {
                 }
         }
 };
+
+//-----------------------------------------------------------------------------
+//
+// TripleBuffer
+//
+// Hands the latest of a stream of values from one writer thread to one
+// reader thread without locks, and without either waiting for the other.
+// Each side owns a slot of its own; the third is in the middle. The writer
+// fills its slot and exchanges it for the middle one; the reader, when the
+// middle slot holds a value it has not seen, exchanges its slot for it.
+// Values the reader was too slow to take are overwritten.
+//
+//-----------------------------------------------------------------------------
+
+template <typename T>
+struct TripleBuffer {
+        static const int FRESH = 4; // the middle slot has not been read
+
+        T slots[3];
+        int back, front;        // owned by the writer, the reader
+        volatile int middle;    // slot index | FRESH
+
+        TripleBuffer() : back(0), front(1), middle(2) {}
+
+        // the writer's slot, to fill before publish()
+        T &write_slot() { return slots[back]; }
+
+        void publish() {
+                back = exchange(back | FRESH) & ~FRESH;
+        }
+
+        // whether there is a new value, which is then read_slot()
+        bool fetch() {
+                if (!(middle & FRESH))
+                        return false;
+                front = exchange(front) & ~FRESH;
+                return true;
+        }
+
+        T &read_slot() { return slots[front]; }
+
+        // full barrier, so the slot given away is settled first
+        int exchange(int v) {
+                int old;
+                do {
+                        old = middle;
+                } while (!__sync_bool_compare_and_swap(&middle, old, v));
+                return old;
+        }
+};
+
+//-----------------------------------------------------------------------------
+//
+// AsyncGBoard
+//
+// A GBoard drawn by a thread of its own, so the game never waits on OpenGL:
+// update() copies the position into a TripleBuffer and returns, and the
+// render thread draws the latest position at most FPS times a second,
+// skipping positions it was too slow for. The thread starts, and opens the
+// window, on the first update(), so a board that is never shown costs
+// nothing.
+//
+// Setting the environment variable NO_DISPLAY, or clearing enabled, turns
+// the board off at runtime: update() does nothing, and the games print
+// their positions as text instead.
+//
+// Closing the window exits, as with GBoard.
+//
+// GLFW may only be used from the main thread on OS X (Cocoa), so there the
+// board is drawn by update() itself, on the caller's thread, as GBoard is:
+// the render thread is for Linux (X11) only.
+//
+//-----------------------------------------------------------------------------
+
+struct AsyncGBoard {
+        struct Snapshot {
+                GBoard::Type type;
+                double bsize;
+                GBoard::player_t b, w;
+        };
+
+        static const size_t FPS = 30;
+
+        int width, height;
+        double bsize;
+        bool enabled;
+        TripleBuffer<Snapshot> buffer;
+        pthread_t thread;
+        bool started;
+        volatile int stopped;
+#ifdef __APPLE__
+        GBoard *board; // opened by the first update()
+#endif
+
+        AsyncGBoard(int w, int h, double size)
+                : width(w), height(h), bsize(size),
+                  enabled(!getenv("NO_DISPLAY")),
+                  started(false), stopped(0)
+#ifdef __APPLE__
+                , board(0)
+#endif
+        {}
+
+        // draws what was last updated, then closes the window
+        ~AsyncGBoard() {
+                if (!started || pthread_equal(thread, pthread_self()))
+                        return;
+                stopped = 1;
+                pthread_join(thread, NULL);
+        }
+
+        void update(GBoard::Type t, GBoard::player_t &b, GBoard::player_t &w) {
+                if (!enabled)
+                        return;
+#ifdef __APPLE__
+                if (!board)
+                        board = new GBoard(width, height, bsize);
+                board->bsize = bsize;
+                board->update(t, b, w);
+                return;
+#endif
+                Snapshot &s = buffer.write_slot();
+                s.type = t;
+                s.bsize = bsize;
+                s.b = b;
+                s.w = w;
+                buffer.publish();
+                if (!started) {
+                        started = true;
+                        pthread_create(&thread, NULL, spawn_thread, this);
+                }
+        }
+
+        static void *spawn_thread(void *self) {
+                ((AsyncGBoard *) self)->render();
+                return NULL;
+        }
+
+        // GLFW is used from this thread only
+        void render() {
+                GBoard board(width, height, bsize);
+                bool shown = false;
+                Stopwatch sw;
+                while (true) {
+                        bool stop = stopped;
+                        sw.reset();
+                        shown |= buffer.fetch();
+                        // redrawn every frame, which also handles the window's events
+                        if (shown) {
+                                Snapshot &s = buffer.read_slot();
+                                board.bsize = s.bsize;
+                                board.update(s.type, s.b, s.w);
+                        }
+                        if (stop)
+                                break;
+                        double rest = 1.0 / FPS - sw.elapsed();
+                        if (rest > 0)
+                                usleep(rest * 1e6);
+                }
+                board.window.close();
+        }
+};
+
+#pragma pack(pop)